@@ -10,6 +10,9 @@
  * Developer: Thorinside (Neal Sanche)
  * Plugin ID: Dr (Drift)
  * GUID: ThDr
+ *
+ * This file is the distingNT side - parameters, sample loading, display
+ * and pots; the engine itself is in drifters_engine.h.
  */
 
 #include <distingnt/api.h>
@@ -18,267 +21,7 @@
 #include <new>
 #include <cstring>
 
-// M_PI may not be defined in all environments
-#ifndef M_PI
-#define M_PI 3.14159265358979323846f
-#endif
-
-// ============================================================================
-// CONSTANTS
-// ============================================================================
-
-static constexpr int kNumDrifters = 4;
-static constexpr int kMaxGrainsPerDrifter = 4;
-static constexpr int kMaxTotalGrains = kNumDrifters * kMaxGrainsPerDrifter;
-static constexpr int kMaxActiveGrains = 8;  // CPU limit - stop rendering beyond this
-static constexpr int kMaxSampleFrames = 48000 * 32;  // 32 seconds at 48kHz
-static constexpr int kWaveformOverviewWidth = 236;   // Pixels for waveform display
-
-
-// Filter bank center frequencies (Hz) - lowest at 250Hz to avoid granular artifacts
-static constexpr float kBandCenterFreqs[kNumDrifters] = { 250.0f, 750.0f, 1550.0f, 4000.0f };
-// Note: Stereo panning is now dynamic based on drifter position relative to anchor
-// Clock phase offsets for each drifter (used for quantized clock mode)
-// static constexpr float kClockPhaseOffset[kNumDrifters] = { 0.0f, 0.25f, 0.5f, 0.75f };
-
-// ============================================================================
-// GRAIN ENVELOPE SHAPES
-// ============================================================================
-
-enum GrainShape {
-    kShapeMist = 0,    // Soft gaussian
-    kShapeCloud,       // Tukey window
-    kShapeRain,        // Triangle
-    kShapeHail,        // Sharp attack, soft decay
-    kShapeIce,         // Square-ish
-    kNumShapes
-};
-
-static const char* const shapeNames[] = {
-    "Mist",
-    "Cloud",
-    "Rain",
-    "Hail",
-    "Ice",
-    NULL
-};
-
-struct Scale {
-    const int8_t* notes;
-    uint8_t noteCount;
-};
-
-static const char* const offOnNames[] = {
-    "Off",
-    "On",
-    NULL
-};
-
-static const char* const scaleNames[] = {
-    "Chromatic",
-    "Ionian",
-    "Dorian",
-    "Phrygian",
-    "Lydian",
-    "Mixolydian",
-    "Aeolian",
-    "Locrian",
-    "Major b6",
-    "Minor b6",
-    "Lydian #4",
-    "Hungarian",
-    "Persian",
-    "Byzantine",
-    "Enigmatic",
-    "Neapolitan",
-    "Hirajoshi",
-    "Iwato",
-    "Pelog",
-    "Ryo",
-    "Ritsu",
-    "Yo",
-    NULL
-};
-
-static const int8_t scaleChromatic[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
-static const int8_t scaleIonian[] = { 0, 2, 4, 5, 7, 9, 11 };
-static const int8_t scaleDorian[] = { 0, 2, 3, 5, 7, 9, 10 };
-static const int8_t scalePhrygian[] = { 0, 1, 3, 5, 7, 8, 10 };
-static const int8_t scaleLydian[] = { 0, 2, 4, 6, 7, 9, 11 };
-static const int8_t scaleMixolydian[] = { 0, 2, 4, 5, 7, 9, 10 };
-static const int8_t scaleAeolian[] = { 0, 2, 3, 5, 7, 8, 10 };
-static const int8_t scaleLocrian[] = { 0, 1, 3, 5, 6, 8, 10 };
-static const int8_t scaleMajorFlat6[] = { 0, 2, 4, 5, 7, 8, 11 };
-static const int8_t scaleMinorFlat6[] = { 0, 2, 3, 5, 7, 8, 10 };
-static const int8_t scaleLydianSharp4[] = { 0, 2, 4, 6, 7, 9, 10 };
-static const int8_t scaleHungarian[] = { 0, 2, 3, 6, 7, 8, 11 };
-static const int8_t scalePersian[] = { 0, 1, 4, 5, 6, 8, 11 };
-static const int8_t scaleByzantine[] = { 0, 1, 4, 5, 7, 8, 11 };
-static const int8_t scaleEnigmatic[] = { 0, 1, 4, 6, 8, 10, 11 };
-static const int8_t scaleNeapolitan[] = { 0, 1, 3, 5, 7, 8, 11 };
-static const int8_t scaleHirajoshi[] = { 0, 2, 3, 7, 8 };
-static const int8_t scaleIwato[] = { 0, 1, 5, 6, 10 };
-static const int8_t scalePelog[] = { 0, 1, 3, 7, 10 };
-static const int8_t scaleRyo[] = { 0, 2, 4, 7, 9 };
-static const int8_t scaleRitsu[] = { 0, 2, 5, 7, 9 };
-static const int8_t scaleYo[] = { 0, 2, 5, 7, 10 };
-
-static const Scale scales[] = {
-    { scaleChromatic, 12 },
-    { scaleIonian, 7 },
-    { scaleDorian, 7 },
-    { scalePhrygian, 7 },
-    { scaleLydian, 7 },
-    { scaleMixolydian, 7 },
-    { scaleAeolian, 7 },
-    { scaleLocrian, 7 },
-    { scaleMajorFlat6, 7 },
-    { scaleMinorFlat6, 7 },
-    { scaleLydianSharp4, 7 },
-    { scaleHungarian, 7 },
-    { scalePersian, 7 },
-    { scaleByzantine, 7 },
-    { scaleEnigmatic, 7 },
-    { scaleNeapolitan, 7 },
-    { scaleHirajoshi, 5 },
-    { scaleIwato, 5 },
-    { scalePelog, 5 },
-    { scaleRyo, 5 },
-    { scaleRitsu, 5 },
-    { scaleYo, 5 }
-};
-
-// Check if a semitone is in the major scale
-static bool isInMajorScale(int8_t semitone) {
-    // Major scale semitones: 0, 2, 4, 5, 7, 9, 11
-    semitone = ((semitone % 12) + 12) % 12;  // Normalize to 0-11
-    return semitone == 0 || semitone == 2 || semitone == 4 ||
-           semitone == 5 || semitone == 7 || semitone == 9 || semitone == 11;
-}
-
-// ============================================================================
-// DATA STRUCTURES
-// ============================================================================
-
-// Simple 2-pole state variable filter for each drifter
-struct BandFilter {
-    float lowpass;
-    float bandpass;
-    float highpass;
-
-    void reset() { lowpass = bandpass = highpass = 0; }
-
-    // Flush denormals to zero
-    static inline float flushDenormal(float x) {
-        return (fabsf(x) < 1e-20f) ? 0.0f : x;
-    }
-
-    float process(float input, float freq, float q, float sr) {
-        // Clamp frequency coefficient for stability
-        float f = 2.0f * sinf(M_PI * fminf(freq, sr * 0.4f) / sr);
-        f = fminf(f, 0.7f);  // Conservative stability limit
-
-        // Clamp Q to prevent instability
-        q = fminf(q, 0.95f);
-
-        lowpass += f * bandpass;
-        highpass = input - lowpass - q * bandpass;
-        bandpass += f * highpass;
-
-        // Prevent denormals and NaN
-        lowpass = flushDenormal(lowpass);
-        bandpass = flushDenormal(bandpass);
-        highpass = flushDenormal(highpass);
-
-        // NaN protection
-        if (lowpass != lowpass) lowpass = 0;
-        if (bandpass != bandpass) bandpass = 0;
-        if (highpass != highpass) highpass = 0;
-
-        return bandpass;  // Use bandpass for spectral separation
-    }
-};
-
-// Single grain instance
-struct Grain {
-    bool active;
-    float position;        // Playback position in samples
-    float positionDelta;   // Playback rate (pitch)
-    float phase;           // Envelope phase 0-1
-    float phaseDelta;      // Envelope rate
-    int drifterIndex;      // Which drifter spawned this grain
-    GrainShape shape;      // Envelope shape
-    float amplitude;       // Grain amplitude
-    BandFilter filterL;    // Per-grain stereo filter
-    BandFilter filterR;
-};
-
-// Drifter state
-struct Drifter {
-    float position;        // Current position in sample (0-1)
-    float velocity;        // Current drift velocity
-    float pitchOffset;     // Pitch offset in semitones
-    float timeSinceGrain;  // Time since last grain trigger
-    float nextGrainTime;   // Time until next grain (Poisson)
-    float variation;       // Per-drifter speed variation (0.5-1.0), set once
-    float driftDirection;  // -1 or +1, set once at init
-    float boredom;         // Builds up when staying in same region (0-1)
-    float lastSignificantPos; // Position when boredom last reset
-};
-
-
-// DTC - Performance critical data
-struct _driftEngine_DTC {
-    Drifter drifters[kNumDrifters];
-    Grain grains[kMaxTotalGrains];
-
-    // Smoothed parameter values
-    float anchorSmooth;
-    float driftSmooth;
-    float densitySmooth;
-    float entropySmooth;
-    float stormLevel;      // Current storm intensity (decays)
-
-    // Clock sync state
-    float clockPhase;
-    float clockPeriod;
-    bool clockReceived;
-    float prevClock;
-
-    // Output for CV
-    float averagePosition;
-    bool pulseOut;
-
-    // Smoothed normalization factor (anti-click)
-    float smoothNorm;
-
-    // Random state
-    uint32_t randState;
-
-    // Live Mode state
-    int writePointer;      // Circular buffer write position
-    bool frozen;           // Freeze state (write pointer stopped)
-    bool prevLiveMode;     // Previous Live Mode state for crossfade detection
-
-    // Crossfade state for mode switching
-    bool crossfadeActive;       // True during mode transition
-    float crossfadeSamples;     // Total crossfade duration in samples (50ms)
-    float crossfadeCounter;     // Current position in crossfade
-    float sampleModeGain;       // Gain for sample mode audio
-    float liveModeGain;         // Gain for live mode audio
-};
-
-// DRAM - Large sample buffer
-struct _driftEngine_DRAM {
-    float sampleBufferL[kMaxSampleFrames];
-    float sampleBufferR[kMaxSampleFrames];
-    int32_t sampleLength;      // Current sample length in frames
-    bool sampleLoaded;
-    bool sampleIsStereo;
-
-    // Waveform overview for display (peak amplitude per pixel column)
-    float waveformOverview[kWaveformOverviewWidth];
-};
+#include "drifters_engine.h"
 
 // ============================================================================
 // PARAMETERS
@@ -339,9 +82,77 @@ enum {
     kParamShape,
     kParamEntropy,
 
+    // Telemetry CV output
+    kParamTelemetry,
+    kParamCvOutTelemetry,
+
+    // Added after release - new parameters go last so saved presets and
+    // mappings keep their indices; pages place them where they belong
+    kParamSeek,
+    kParamMinDelay,
+    kParamQuality,
+
     kNumParameters
 };
 
+// Enum strings, in the order of the engine's GrainShape, Quality, scales[]
+// and TelemetryMode
+static const char* const shapeNames[] = {
+    "Mist",
+    "Cloud",
+    "Rain",
+    "Hail",
+    "Ice",
+    NULL
+};
+
+static const char* const qualityNames[] = {
+    "Eco",
+    "Normal",
+    "HQ",
+    NULL
+};
+
+static const char* const offOnNames[] = {
+    "Off",
+    "On",
+    NULL
+};
+
+static const char* const scaleNames[] = {
+    "Chromatic",
+    "Ionian",
+    "Dorian",
+    "Phrygian",
+    "Lydian",
+    "Mixolydian",
+    "Aeolian",
+    "Locrian",
+    "Major b6",
+    "Minor b6",
+    "Lydian #4",
+    "Hungarian",
+    "Persian",
+    "Byzantine",
+    "Enigmatic",
+    "Neapolitan",
+    "Hirajoshi",
+    "Iwato",
+    "Pelog",
+    "Ryo",
+    "Ritsu",
+    "Yo",
+    NULL
+};
+
+static const char* const telemetryNames[] = {
+    "Triggers",
+    "Drops",
+    "Skips",
+    "Grains",
+    NULL
+};
+
 static const _NT_parameter parameters[] = {
     // Audio outputs
     NT_PARAMETER_AUDIO_OUTPUT_WITH_MODE("Out L", 1, 13)
@@ -392,23 +203,91 @@ static const _NT_parameter parameters[] = {
     // Character
     { .name = "Shape", .min = 0, .max = kNumShapes - 1, .def = 1, .unit = kNT_unitEnum, .scaling = 0, .enumStrings = shapeNames },
     { .name = "Entropy", .min = 0, .max = 100, .def = 25, .unit = kNT_unitPercent, .scaling = 0, .enumStrings = NULL },
+
+    // Telemetry CV output: what it reports, and where (bus 0 = none)
+    { .name = "Telemetry", .min = 0, .max = kNumTelemetryModes - 1, .def = kTelemetryTriggers, .unit = kNT_unitEnum, .scaling = 0, .enumStrings = telemetryNames },
+    NT_PARAMETER_CV_OUTPUT("Telemetry out", 0, 0)
+
+    // Added after release (Position, Sample and Character pages)
+    { .name = "Seek", .min = -100, .max = 100, .def = 0, .unit = kNT_unitPercent, .scaling = 0, .enumStrings = NULL },
+    { .name = "Min delay", .min = 0, .max = 500, .def = 53, .unit = kNT_unitMs, .scaling = kNT_scaling10, .enumStrings = NULL },
+    { .name = "Quality", .min = 0, .max = kNumQualities - 1, .def = kQualityNormal, .unit = kNT_unitEnum, .scaling = 0, .enumStrings = qualityNames },
 };
 
+// ============================================================================
+// SPECIFICATIONS
+// ============================================================================
+
+enum {
+    kSpecCacheSlots,     // Number of samples kept resident in DRAM
+    kSpecSlotSeconds,    // Capacity of each slot (seconds at 48kHz)
+    kSpecPacked,         // 0 = float storage, 1 = int16 (half the DRAM)
+    kSpecResample,       // 0 = store at native rate, 1 = resample at load
+    kSpecStorageKHz,     // Resampling target in kHz (0 = NT sample rate)
+    kSpecLiveSeconds,    // Live Mode buffer length (seconds at the NT rate)
+    kSpecSeed,           // Random seed (0 = the original fixed seed)
+
+    kNumSpecifications
+};
+
+static const _NT_specification specifications[] = {
+    { .name = "Cache slots", .min = 1, .max = kMaxCacheSlots, .def = 1, .type = kNT_typeGeneric },
+    { .name = "Slot seconds", .min = 1, .max = 32, .def = 32, .type = kNT_typeGeneric },
+    { .name = "16-bit cache", .min = 0, .max = 1, .def = 0, .type = kNT_typeGeneric },
+    { .name = "Resample", .min = 0, .max = 1, .def = 0, .type = kNT_typeGeneric },
+    { .name = "Storage kHz", .min = 0, .max = 96, .def = 0, .type = kNT_typeGeneric },
+    { .name = "Live seconds", .min = 1, .max = 32, .def = 16, .type = kNT_typeGeneric },
+    { .name = "Seed", .min = 0, .max = 32767, .def = 0, .type = kNT_typeGeneric },
+};
+
+// Rate samples are stored at when resampling (0 when files keep their native rate)
+static float storageRateForSpec(const int32_t* specifications) {
+    if (!specifications[kSpecResample]) return 0.0f;
+    int32_t kHz = specifications[kSpecStorageKHz];
+    if (kHz == 0) return (float)NT_globals.sampleRate;
+    return (kHz < 8 ? 8 : kHz) * 1000.0f;
+}
+
+// Slot capacity in frames for the given specifications
+// Native-rate storage keeps the historical 48k-frames-per-second sizing
+static int32_t slotFramesForSpec(const int32_t* specifications) {
+    float rate = storageRateForSpec(specifications);
+    return specifications[kSpecSlotSeconds] * (rate > 0 ? (int32_t)rate : 48000);
+}
+
+// Live buffer capacity in frames per channel (captured at the NT rate)
+static int32_t liveFramesForSpec(const int32_t* specifications) {
+    return specifications[kSpecLiveSeconds] * (int32_t)NT_globals.sampleRate;
+}
+
+// Engine memory layout for the given specifications
+static EngineConfig engineConfigForSpec(const int32_t* specifications) {
+    EngineConfig config;
+    config.cacheSlots = specifications[kSpecCacheSlots];
+    config.slotFrames = slotFramesForSpec(specifications);
+    config.packed = specifications[kSpecPacked] != 0;
+    config.storageRate = storageRateForSpec(specifications);
+    config.liveFrames = liveFramesForSpec(specifications);
+    config.seed = specifications[kSpecSeed];
+    return config;
+}
+
 // ============================================================================
 // PARAMETER PAGES
 // ============================================================================
 
-static const uint8_t pageSample[] = { kParamFolder, kParamSample, kParamLiveMode, kParamMix, kParamFreeze };
-static const uint8_t pagePosition[] = { kParamAnchor, kParamWander, kParamGravity, kParamDrift };
+static const uint8_t pageSample[] = { kParamFolder, kParamSample, kParamLiveMode, kParamMix, kParamFreeze, kParamMinDelay };
+static const uint8_t pagePosition[] = { kParamAnchor, kParamWander, kParamGravity, kParamDrift, kParamSeek };
 static const uint8_t pageDensity[] = { kParamDensity, kParamDeviation };
 static const uint8_t pagePitch[] = { kParamPitch, kParamScatter, kParamScale };
 static const uint8_t pageSpectral[] = { kParamSpectrum, kParamTilt };
-static const uint8_t pageCharacter[] = { kParamShape, kParamEntropy };
+static const uint8_t pageCharacter[] = { kParamShape, kParamEntropy, kParamQuality };
 static const uint8_t pageRouting[] = {
     kParamInputL, kParamInputR,
     kParamOutputL, kParamOutputLMode, kParamOutputR, kParamOutputRMode,
     kParamCvAnchor, kParamCvPitch, kParamCvDrift, kParamCvEntropy, kParamCvStorm, kParamCvClock,
-    kParamCvOutPosition, kParamCvOutPositionMode, kParamCvOutPulse, kParamCvOutPulseMode
+    kParamCvOutPosition, kParamCvOutPositionMode, kParamCvOutPulse, kParamCvOutPulseMode,
+    kParamTelemetry, kParamCvOutTelemetry
 };
 
 static const _NT_parameterPage pages[] = {
@@ -427,355 +306,264 @@ static const _NT_parameterPages parameterPages = {
 };
 
 // ============================================================================
-// ALGORITHM STRUCTURE
+// SESSION RECORDING (build with -DDRIFTERS_RECORD)
 // ============================================================================
+// Logs what the plugin was given - parameter changes, CV summaries, clock and
+// storm edges, sample loads - stamped with the frame they arrived at, so a
+// session that went badly can be replayed offline (drifters_host --replay).
+// Events go into a ring from step(), parameterChanged() and the load
+// callback, which the module never runs at once; draw() appends them to the
+// file named by DRIFTERS_SESSION (default drifters_session.log).
+// Desktop builds only - the module has nowhere to write the log.
+
+#ifdef DRIFTERS_RECORD
+#ifdef DISTING_HARDWARE
+#error "DRIFTERS_RECORD needs a desktop build (nt_emu or the headless host)"
+#endif
 
-// Forward declaration for callback
-struct _driftEngineAlgorithm;
-static void wavLoadCallback(void* callbackData, bool success);
-
-// Main algorithm structure (like sample player example)
-struct _driftEngineAlgorithm : public _NT_algorithm {
-    _driftEngineAlgorithm(_driftEngine_DTC* dtc_, _driftEngine_DRAM* dram_)
-        : dtc(dtc_), dram(dram_) {}
-    ~_driftEngineAlgorithm() {}
-
-    _driftEngine_DTC* dtc;
-    _driftEngine_DRAM* dram;
-
-    // Mutable copy of parameters (for dynamic max values like sample player example)
-    _NT_parameter params[kNumParameters];
+#include <stdio.h>
+#include <stdlib.h>
 
-    // WAV loading state
-    _NT_wavRequest wavRequest;
-    bool cardMounted;
-    bool awaitingCallback;
-    bool initialized;          // Set after construct completes
-    bool pendingSampleLoad;    // Deferred sample load request
-    int32_t pendingSampleLength; // Length of sample being loaded
-    float pendingSourceSampleRate; // Sample rate of sample being loaded
-    float sourceSampleRate;    // Source sample's native sample rate (calculate ratio on the fly)
+static constexpr int kSessionLogSize = 8192;    // Events between draws (power of 2)
 
-    // Note: Parameter values are read directly from pThis->v[] rather than cached
-    // This ensures we always use current values and simplifies serialisation
+enum SessionEventKind {
+    kEventBlock,         // value: block size
+    kEventParam,         // index: parameter, value: new value
+    kEventCv,            // index: CV input parameter, a/b/c: block min/max/mean
+    kEventEdge,          // index: Storm Gate or Clock, value: 1 rising, 0 falling
+    kEventLoad,          // value/extra: folder/sample, a: frames - a transfer starts
+    kEventCached,        // value/extra: folder/sample - switched to a cached slot
+    kEventLoaded,        // value/extra: folder/sample, a: frames - a transfer lands
+    kEventLoadFailed,    // value/extra: folder/sample
+};
 
-    // Soft takeover state for push+turn (3 pots)
-    bool potButtonWasPressed[3];       // Previous frame button state
-    float lastPotPos[3];               // Previous pot position for delta calculation
-    float normalTarget[3];             // Virtual pot position for normal mode (0-1)
-    float altTarget[3];                // Virtual pot position for alt mode (0-1)
+static const char* const sessionEventNames[] = {
+    "block", "param", "cv", "edge", "load", "cached", "loaded", "load-failed"
 };
 
-// ============================================================================
-// HELPER FUNCTIONS
-// ============================================================================
+struct SessionEvent {
+    uint32_t frame;
+    uint8_t kind;
+    uint8_t index;
+    int16_t value;
+    int16_t extra;
+    float a, b, c;
+};
 
-// Fast pseudo-random number generator (Xorshift32)
-static inline uint32_t xorshift32(uint32_t* state) {
-    uint32_t x = *state;
-    x ^= x << 13;
-    x ^= x >> 17;
-    x ^= x << 5;
-    *state = x;
-    return x;
-}
+// The continuous CV inputs are summarised per block; the gates log edges
+static constexpr int kSessionCvInputs = kParamCvEntropy - kParamCvAnchor + 1;
+static const int sessionGateInputs[] = { kParamCvStorm, kParamCvClock };
+static constexpr int kSessionGateInputs = ARRAY_SIZE(sessionGateInputs);
+
+struct SessionLog {
+    SessionEvent events[kSessionLogSize];
+    volatile uint32_t head;    // Only written by the producers
+    volatile uint32_t tail;    // Only written by draw()
+    volatile uint32_t lost;    // Events dropped on a full ring (producers)
+    uint32_t lostReported;     // Drops already noted in the file (draw())
+    uint32_t frame;            // First frame of the next block
+    int32_t blockSize;
+    bool cvLogged[kSessionCvInputs];
+    float cvLast[kSessionCvInputs][3];    // Last logged min/max/mean
+    bool gateHigh[kSessionGateInputs];
+    int32_t specifications[kNumSpecifications];
+    FILE* file;
+    long endLine;              // Where the closing "end" line starts
+    uint32_t endFrame;         // Frame that line records
+};
 
-// Random float 0-1
-static inline float randFloat(_driftEngine_DTC* dtc) {
-    return (float)xorshift32(&dtc->randState) / (float)0xFFFFFFFF;
+static void sessionInit(SessionLog& log, const int32_t* specifications) {
+    log.head = log.tail = log.lost = 0;
+    log.lostReported = 0;
+    log.frame = 0;
+    log.blockSize = 0;
+    memset(log.cvLogged, 0, sizeof(log.cvLogged));
+    memset(log.gateHigh, 0, sizeof(log.gateHigh));
+    memcpy(log.specifications, specifications, sizeof(log.specifications));
+    log.file = NULL;
+    log.endFrame = 0;
 }
 
-// Find nearest zero crossing in sample buffer
-static int findNearestZeroCrossing(const float* buffer, int startPos, int sampleLen, int searchRadius = 64) {
-    // Guard against division by zero
-    if (sampleLen <= 0) return 0;
-
-    int bestPos = startPos % sampleLen;
-    float bestVal = fabsf(buffer[bestPos]);
-
-    for (int offset = 1; offset <= searchRadius; offset++) {
-        // Search forward
-        int posF = (startPos + offset) % sampleLen;
-        float valF = fabsf(buffer[posF]);
-        if (valF < bestVal) {
-            bestVal = valF;
-            bestPos = posF;
-        }
-        // Also check for actual zero crossing (sign change)
-        if (offset > 0) {
-            int prevF = (startPos + offset - 1) % sampleLen;
-            if (buffer[prevF] * buffer[posF] < 0) {
-                // Zero crossing found
-                return (fabsf(buffer[prevF]) < fabsf(buffer[posF])) ? prevF : posF;
-            }
-        }
-
-        // Search backward
-        int posB = (startPos - offset + sampleLen) % sampleLen;
-        float valB = fabsf(buffer[posB]);
-        if (valB < bestVal) {
-            bestVal = valB;
-            bestPos = posB;
-        }
-        if (offset > 0) {
-            int prevB = (startPos - offset + 1 + sampleLen) % sampleLen;
-            if (buffer[prevB] * buffer[posB] < 0) {
-                return (fabsf(buffer[prevB]) < fabsf(buffer[posB])) ? prevB : posB;
-            }
-        }
+static void sessionPush(SessionLog& log, uint8_t kind, int index, int value, int extra = 0,
+                        float a = 0, float b = 0, float c = 0, uint32_t offset = 0) {
+    uint32_t head = log.head;
+    if (head - log.tail >= (uint32_t)kSessionLogSize) {
+        log.lost++;
+        return;
     }
-
-    return bestPos;
+    SessionEvent& e = log.events[head & (kSessionLogSize - 1)];
+    e.frame = log.frame + offset;
+    e.kind = kind;
+    e.index = (uint8_t)index;
+    e.value = (int16_t)value;
+    e.extra = (int16_t)extra;
+    e.a = a;
+    e.b = b;
+    e.c = c;
+    __sync_synchronize();  // Publish the event before the index that exposes it
+    log.head = head + 1;
 }
 
-// Random float -1 to +1
-static inline float randFloatBipolar(_driftEngine_DTC* dtc) {
-    return randFloat(dtc) * 2.0f - 1.0f;
-}
-
-// Exponential distribution for Poisson process
-static inline float randExponential(_driftEngine_DTC* dtc, float lambda) {
-    float u = randFloat(dtc);
-    if (u < 0.0001f) u = 0.0001f;  // Avoid log(0)
-    return -logf(u) / lambda;
-}
-
-// Get a random scale degree, biased toward characteristic notes (those not in major)
-// Returns a degree offset (can be negative or positive)
-static int getCharacteristicDegree(_driftEngine_DTC* dtc, int scaleIndex, int maxDegrees) {
-    if (scaleIndex <= 1) {  // Chromatic or Ionian - no bias needed
-        return (int)(randFloat(dtc) * (maxDegrees * 2 + 1)) - maxDegrees;
+// Called at the top of step(): the block size when it changes, a summary of
+// each patched CV input when it moved, and every gate edge at its frame
+static void sessionBeginBlock(SessionLog& log, const int16_t* v, const float* busFrames, int numFrames) {
+    if (numFrames != log.blockSize) {
+        sessionPush(log, kEventBlock, 0, numFrames);
+        log.blockSize = numFrames;
     }
 
-    const Scale& scale = scales[scaleIndex];
-
-    // Try up to 4 times to find a characteristic note
-    for (int attempt = 0; attempt < 4; attempt++) {
-        int degree = (int)(randFloat(dtc) * (maxDegrees * 2 + 1)) - maxDegrees;
-
-        // Get the semitone for this degree
-        int octave = degree / (int)scale.noteCount;
-        int degreeInOctave = degree % (int)scale.noteCount;
-        if (degreeInOctave < 0) {
-            degreeInOctave += scale.noteCount;
-            octave -= 1;
+    for (int c = 0; c < kSessionCvInputs; c++) {
+        int p = kParamCvAnchor + c;
+        if (v[p] == 0) {
+            log.cvLogged[c] = false;
+            continue;
         }
-        int8_t semitone = scale.notes[degreeInOctave];
-
-        // If this note is NOT in major scale, prefer it (70% chance to keep)
-        if (!isInMajorScale(semitone)) {
-            if (randFloat(dtc) < 0.7f) {
-                return degree;
-            }
+        const float* cv = busFrames + (v[p] - 1) * numFrames;
+        float lo = cv[0], hi = cv[0], sum = 0;
+        for (int i = 0; i < numFrames; i++) {
+            lo = fminf(lo, cv[i]);
+            hi = fmaxf(hi, cv[i]);
+            sum += cv[i];
         }
-        // If in major scale, only 30% chance to keep, otherwise try again
-        if (randFloat(dtc) < 0.3f) {
-            return degree;
+        float summary[3] = { lo, hi, sum / numFrames };
+        bool moved = !log.cvLogged[c];
+        for (int k = 0; k < 3; k++) moved |= fabsf(summary[k] - log.cvLast[c][k]) > 0.001f;
+        if (moved) {
+            sessionPush(log, kEventCv, p, 0, 0, lo, hi, summary[2]);
+            memcpy(log.cvLast[c], summary, sizeof(summary));
+            log.cvLogged[c] = true;
         }
     }
 
-    // Fallback: return last attempted degree
-    return (int)(randFloat(dtc) * (maxDegrees * 2 + 1)) - maxDegrees;
-}
-
-// Compute grain envelope value
-static float grainEnvelope(float phase, GrainShape shape) {
-    if (phase < 0 || phase > 1) return 0;
-
-    // Universal safety fade at boundaries (3% fade-in/out for click reduction)
-    float fade = 1.0f;
-    const float fadeLen = 0.03f;
-    if (phase < fadeLen) fade = phase / fadeLen;
-    else if (phase > 1.0f - fadeLen) fade = (1.0f - phase) / fadeLen;
-
-    float env = 1.0f;
-    switch (shape) {
-        case kShapeMist: {
-            // Gaussian-ish: sin^2 approximation
-            float x = phase * M_PI;
-            float s = sinf(x);
-            env = s * s;
-            break;
-        }
-        case kShapeCloud: {
-            // Tukey window (tapered cosine)
-            float alpha = 0.5f;
-            if (phase < alpha/2) {
-                env = 0.5f * (1 - cosf(2*M_PI*phase/alpha));
-            } else if (phase > 1 - alpha/2) {
-                env = 0.5f * (1 - cosf(2*M_PI*(1-phase)/alpha));
-            } else {
-                env = 1.0f;
+    // Same 1V threshold as step()
+    for (int g = 0; g < kSessionGateInputs; g++) {
+        int p = sessionGateInputs[g];
+        const float* gate = v[p] ? busFrames + (v[p] - 1) * numFrames : NULL;
+        for (int i = 0; i < numFrames; i++) {
+            bool high = gate && gate[i] > 1.0f;
+            if (high != log.gateHigh[g]) {
+                sessionPush(log, kEventEdge, p, high, 0, 0, 0, 0, i);
+                log.gateHigh[g] = high;
             }
-            break;
-        }
-        case kShapeRain:
-            // Triangle
-            env = phase < 0.5f ? phase * 2 : (1 - phase) * 2;
-            break;
-
-        case kShapeHail: {
-            // Sharp attack, exponential decay
-            if (phase < 0.1f) env = phase * 10;
-            else env = expf(-4.0f * (phase - 0.1f));
-            break;
         }
-
-        case kShapeIce:
-            // Near-square with tiny fade
-            if (phase < 0.02f) env = phase * 50;
-            else if (phase > 0.98f) env = (1 - phase) * 50;
-            else env = 1.0f;
-            break;
-
-        default:
-            env = 1.0f;
-            break;
     }
 
-    return env * fade;
-}
-
-// Map density (0-100) to grains per second
-static float densityToRate(float density) {
-    // 0% -> 0.25 grains/sec (sparse!), 100% -> 50 grains/sec
-    // NOT a perfect inverse of size - allows gaps at low density
-    return 0.25f * powf(200.0f, density / 100.0f);
+    log.frame += numFrames;
 }
 
-// Map density to grain size in seconds
-static float densityToSize(float density) {
-    // 0% -> 0.5s, 100% -> 100ms
-    // Less aggressive size reduction - grains stay longer
-    return 0.5f * powf(0.2f, density / 100.0f);
-}
-
-// Simple autocorrelation pitch detector
-// Returns detected pitch as semitones from A4 (440Hz), or 0 if no clear pitch
-// buffer: audio buffer to analyze
-// startPos: position in buffer to start analysis
-// bufferLen: total buffer length (for wrapping)
-// sampleRate: sample rate in Hz
-static float detectPitch(const float* buffer, int startPos, int bufferLen, float sampleRate) {
-    const int windowSize = 512;  // Analysis window
-    const int minLag = (int)(sampleRate / 2000.0f);  // Max freq ~2000Hz
-    const int maxLag = (int)(sampleRate / 60.0f);    // Min freq ~60Hz
-
-    if (maxLag >= windowSize) return 0.0f;  // Safety check
-
-    float bestCorr = 0.0f;
-    int bestLag = 0;
-
-    // Simple autocorrelation - find lag with highest correlation
-    for (int lag = minLag; lag < maxLag; lag++) {
-        float corr = 0.0f;
-        float energy = 0.0f;
-
-        for (int i = 0; i < windowSize - lag; i++) {
-            int pos1 = (startPos + i) % bufferLen;
-            int pos2 = (startPos + i + lag) % bufferLen;
-            corr += buffer[pos1] * buffer[pos2];
-            energy += buffer[pos1] * buffer[pos1];
+// Called from draw(): append whatever step() and friends have logged since
+static void sessionWrite(SessionLog& log) {
+    uint32_t frame = log.frame;
+    if (log.head == log.tail && log.lost == log.lostReported && frame == log.endFrame) return;
+    if (!log.file) {
+        const char* path = getenv("DRIFTERS_SESSION");
+        log.file = fopen(path ? path : "drifters_session.log", "w");
+        if (!log.file) {
+            log.tail = log.head;
+            return;
         }
-
-        // Normalize correlation
-        if (energy > 0.0001f) {
-            corr /= energy;
+        fprintf(log.file, "# drifters session 1\n");
+        fprintf(log.file, "rate %u\n", (unsigned)NT_globals.sampleRate);
+        for (int i = 0; i < kNumSpecifications; i++) {
+            fprintf(log.file, "spec %d %d\n", i, (int)log.specifications[i]);
         }
+    } else {
+        fseek(log.file, log.endLine, SEEK_SET);
+    }
 
-        if (corr > bestCorr) {
-            bestCorr = corr;
-            bestLag = lag;
+    uint32_t head = log.head;
+    __sync_synchronize();  // Read the events only after the index that exposes them
+    for (uint32_t t = log.tail; t != head; t++) {
+        const SessionEvent& e = log.events[t & (kSessionLogSize - 1)];
+        fprintf(log.file, "%u %s", (unsigned)e.frame, sessionEventNames[e.kind]);
+        switch (e.kind) {
+            case kEventBlock: fprintf(log.file, " %d\n", e.value); break;
+            case kEventParam: case kEventEdge: fprintf(log.file, " %d %d\n", e.index, e.value); break;
+            case kEventCv: fprintf(log.file, " %d %.6g %.6g %.6g\n", e.index, e.a, e.b, e.c); break;
+            case kEventLoad: case kEventLoaded: fprintf(log.file, " %d %d %.0f\n", e.value, e.extra, e.a); break;
+            default: fprintf(log.file, " %d %d\n", e.value, e.extra); break;
         }
     }
-
-    // Require reasonable correlation strength
-    if (bestCorr < 0.3f || bestLag == 0) {
-        return 0.0f;  // No clear pitch detected
+    log.tail = head;
+    uint32_t lost = log.lost;
+    if (lost != log.lostReported) {
+        fprintf(log.file, "# %u events lost (draw() fell behind)\n", (unsigned)(lost - log.lostReported));
+        log.lostReported = lost;
     }
 
-    // Convert lag to frequency, then to semitones from A4
-    // Use log() instead of log2f() - C++ overload inlines to builtin
-    // log2(x) = log(x) / log(2) = log(x) * 1.4427f
-    float freq = sampleRate / (float)bestLag;
-    float semitones = 12.0f * log(freq / 440.0f) * 1.4427f;
-
-    return semitones;
+    // The log always closes with the frame reached, so a replay runs as long
+    // as the session did; the next write goes over it
+    log.endLine = ftell(log.file);
+    log.endFrame = frame;
+    fprintf(log.file, "%u end\n", (unsigned)frame);
+    fflush(log.file);
 }
 
-// Calculate per-drifter volume based on tilt (linear approximation, avoids powf)
-static float tiltVolume(int drifterIndex, float tilt) {
-    // tilt: -1 (dark) to +1 (bright)
-    // D1 (bass) gets louder when tilt negative, D4 (air) gets louder when positive
-    float normalizedIndex = (float)drifterIndex / (kNumDrifters - 1);  // 0 to 1
-    float tiltEffect = (normalizedIndex - 0.5f) * 2.0f * tilt;  // -1 to +1 range
-    // Linear approximation of ±6dB: 1 + 0.5*x gives roughly 0.5 to 1.5 range
-    return 1.0f + tiltEffect * 0.5f;
-}
-
-// Converts a scale degree to semitones with octave wrapping
-// degree: Scale degree (can be negative or > scale size)
-// scaleIndex: Index into scales[] array (0 = chromatic)
-// Returns: Semitone offset from root
-float degreeToSemitones(int degree, int scaleIndex) {
-    // Chromatic bypass: degrees = semitones
-    if (scaleIndex == 0) {
-        return (float)degree;
-    }
+#define SESSION_EVENT(alg, ...) sessionPush((alg)->session, __VA_ARGS__)
+#else
+#define SESSION_EVENT(alg, ...)
+#endif
 
-    const Scale& scale = scales[scaleIndex];
+// ============================================================================
+// ALGORITHM STRUCTURE
+// ============================================================================
 
-    // Calculate which octave we're in and degree within that octave
-    int octave = degree / (int)scale.noteCount;
-    int degreeInOctave = degree % (int)scale.noteCount;
+// Forward declaration for callback
+struct _driftEngineAlgorithm;
+static void wavLoadCallback(void* callbackData, bool success);
 
-    // Handle negative modulo correctly (C++ % can give negative results)
-    if (degreeInOctave < 0) {
-        degreeInOctave += scale.noteCount;
-        octave -= 1;
-    }
+// Main algorithm structure (like sample player example)
+struct _driftEngineAlgorithm : public _NT_algorithm {
+    _driftEngineAlgorithm() {}
+    ~_driftEngineAlgorithm() {}
 
-    // Convert to semitones: octaves + scale degree offset
-    return (float)(octave * 12 + scale.notes[degreeInOctave]);
-}
+    DriftEngine engine;
+    bool liveParamsShown;      // Mix and Min delay are un-greyed for Live Mode
 
-// Quantizes a pitch in semitones to the nearest scale degree
-// semitones: Pitch as semitone offset from root
-// scaleIndex: Index into scales[] array (0 = chromatic)
-// Returns: Quantized semitone value
-float quantizePitchToScale(float semitones, int scaleIndex) {
-    // Chromatic bypass: no quantization
-    if (scaleIndex == 0) {
-        return semitones;
-    }
+    // Mutable copy of parameters (for dynamic max values like sample player example)
+    _NT_parameter params[kNumParameters];
 
-    const Scale& scale = scales[scaleIndex];
+    // WAV loading state
+    _NT_wavRequest wavRequest;
+    bool cardMounted;
+    bool awaitingCallback;     // A chunk read is in flight (buffer owned by the card)
+    bool initialized;          // Set after construct completes
 
-    // Determine which octave and semitone within octave
-    int octave = (int)floorf(semitones / 12.0f);
-    float semisInOctave = semitones - (octave * 12.0f);
+    // Sample load queue (latest-wins)
+    // Every request bumps loadRequestSerial; only the newest one is ever served.
+    // Files are read in chunks so a stale transfer can be abandoned between reads.
+    uint32_t loadRequestSerial;    // Serial of the newest load request
+    uint32_t loadServedSerial;     // Serial of the newest request handled (cache hit or transfer)
+    uint32_t loadTransferSerial;   // Serial of the request the current transfer serves
+    bool loadActive;               // Chunked transfer in progress
+    int32_t loadSlot;              // Cache slot the transfer writes into
+    bool loadChunkFailed;          // Last chunk read reported an error
+    int32_t pendingSampleLength;   // Total frames of the sample being loaded
+    int32_t loadNextFrame;         // Next frame offset to request
+    int32_t loadChunkLength;       // Frames in the chunk currently in flight
+    float pendingSourceSampleRate; // Sample rate of sample being loaded
 
-    // Handle negative case
-    if (semisInOctave < 0.0f) {
-        semisInOctave += 12.0f;
-        octave -= 1;
-    }
+    // Streaming resampler state (chunks are converted as they arrive)
+    bool loadResampling;           // Transfer goes through the resampler
+    double resampleStep;           // Input frames per output frame
+    int32_t resampleInBase;        // Input frame index of the chunk in staging
+    int32_t resampleOutFrames;     // Output frames written so far
+    int32_t resampleOutTotal;      // Output frames this load produces
 
-    // Find nearest scale note
-    int nearestIdx = 0;
-    float minDist = fabsf(semisInOctave - scale.notes[0]);
+    // Note: Parameter values are read directly from pThis->v[] rather than cached
+    // This ensures we always use current values and simplifies serialisation;
+    // step() hands them to the engine as EngineParams
 
-    for (int i = 1; i < scale.noteCount; i++) {
-        float dist = fabsf(semisInOctave - scale.notes[i]);
-        if (dist < minDist) {
-            minDist = dist;
-            nearestIdx = i;
-        }
-    }
+    // Soft takeover state for push+turn (3 pots)
+    bool potButtonWasPressed[3];       // Previous frame button state
+    float lastPotPos[3];               // Previous pot position for delta calculation
+    float normalTarget[3];             // Virtual pot position for normal mode (0-1)
+    float altTarget[3];                // Virtual pot position for alt mode (0-1)
 
-    // Convert back to absolute semitones
-    return (float)(octave * 12 + scale.notes[nearestIdx]);
-}
+#ifdef DRIFTERS_RECORD
+    SessionLog session;
+#endif
+};
 
 // ============================================================================
 // FACTORY FUNCTIONS
@@ -784,45 +572,135 @@ float quantizePitchToScale(float semitones, int scaleIndex) {
 void calculateRequirements(_NT_algorithmRequirements& req, const int32_t* specifications) {
     req.numParameters = ARRAY_SIZE(parameters);
     req.sram = sizeof(_driftEngineAlgorithm);
-    req.dram = sizeof(_driftEngine_DRAM);
+    req.dram = engineDramBytes(engineConfigForSpec(specifications));
     req.dtc = sizeof(_driftEngine_DTC);
     req.itc = 0;
 }
 
-// Callback when WAV loading completes (like sample player example)
-// Compute waveform overview for display (peak amplitude per pixel)
-static void computeWaveformOverview(_driftEngine_DRAM* dram) {
-    if (dram->sampleLength <= 0) return;
-
-    float samplesPerPixel = (float)dram->sampleLength / kWaveformOverviewWidth;
+// Convert the chunk sitting in the staging buffer and append it to the load slot
+// Staging holds kResampleTaps frames of history followed by the new chunk; output
+// frames whose kernel would reach past the chunk wait for the next one
+static void resampleChunk(_driftEngineAlgorithm* pThis, bool finalChunk) {
+    _driftEngine_DRAM* dram = pThis->engine.dram;
+    SampleSlot& slot = dram->slots[pThis->loadSlot];
+    float* staging = dram->resampleStaging;
+    const int half = kResampleTaps / 2;
+    int32_t chunk = pThis->loadChunkLength;
+    int32_t available = pThis->resampleInBase + chunk;
+
+    if (finalChunk) {
+        // Zero padding past the end of the file
+        memset(staging + kResampleTaps + chunk, 0, kResampleTaps * sizeof(float));
+    }
 
-    for (int px = 0; px < kWaveformOverviewWidth; px++) {
-        int startSample = (int)(px * samplesPerPixel);
-        int endSample = (int)((px + 1) * samplesPerPixel);
-        if (endSample > dram->sampleLength) endSample = dram->sampleLength;
+    while (pThis->resampleOutFrames < pThis->resampleOutTotal) {
+        double t = pThis->resampleOutFrames * pThis->resampleStep;
+        int32_t i = (int32_t)t;
+        if (!finalChunk && i + half >= available) break;
+
+        float phase = (float)(t - i) * kResamplePhases;
+        int p = (int)phase;
+        float pf = phase - p;
+        const float* row0 = dram->resampleKernel[p];
+        const float* row1 = dram->resampleKernel[p + 1];
+        const float* in = staging + kResampleTaps + (i - pThis->resampleInBase) - (half - 1);
+
+        float acc = 0;
+        for (int k = 0; k < kResampleTaps; k++) {
+            acc += (row0[k] + pf * (row1[k] - row0[k])) * in[k];
+        }
 
-        float maxAmp = 0;
-        for (int s = startSample; s < endSample; s++) {
-            float amp = fabsf(dram->sampleBufferL[s]);
-            if (amp > maxAmp) maxAmp = amp;
+        int32_t out = pThis->resampleOutFrames++;
+        if (slot.packed) {
+            float v = fmaxf(-1.0f, fminf(32767.0f / 32768.0f, acc));
+            slot.packed[out] = (int16_t)(v * 32768.0f);
+        } else {
+            slot.frames[out] = acc;
         }
-        dram->waveformOverview[px] = maxAmp;
     }
+
+    // Carry the tail of this chunk over as history for the next one
+    memmove(staging, staging + chunk, kResampleTaps * sizeof(float));
+    pThis->resampleInBase = available;
 }
 
 static void wavLoadCallback(void* callbackData, bool success) {
     _driftEngineAlgorithm* pThis = (_driftEngineAlgorithm*)callbackData;
     pThis->awaitingCallback = false;
 
-    if (success) {
+    if (!success) {
+        pThis->loadChunkFailed = true;
+        SESSION_EVENT(pThis, kEventLoadFailed, 0, pThis->wavRequest.folder, pThis->wavRequest.sample);
+        return;
+    }
+
+    // Stale transfers are dropped by serviceSampleLoads() on the next step
+    if (pThis->loadTransferSerial != pThis->loadRequestSerial) {
+        return;
+    }
+
+    bool lastChunk = pThis->loadNextFrame >= pThis->pendingSampleLength;
+    if (pThis->loadResampling) {
+        resampleChunk(pThis, lastChunk);
+    }
+
+    // Only the final chunk of the newest request gets applied
+    if (lastChunk) {
         // Apply the pending sample info now that load is complete
-        pThis->dram->sampleLength = pThis->pendingSampleLength;
-        pThis->sourceSampleRate = pThis->pendingSourceSampleRate;
-        pThis->dram->sampleLoaded = true;
+        _driftEngine_DRAM* dram = pThis->engine.dram;
+        SampleSlot& slot = dram->slots[pThis->loadSlot];
+        slot.folder = pThis->wavRequest.folder;
+        slot.sample = pThis->wavRequest.sample;
+        if (pThis->loadResampling) {
+            engineSlotLoaded(&pThis->engine, pThis->loadSlot, pThis->resampleOutFrames, dram->storageRate);
+        } else {
+            engineSlotLoaded(&pThis->engine, pThis->loadSlot, pThis->pendingSampleLength,
+                             pThis->pendingSourceSampleRate);
+        }
+        SESSION_EVENT(pThis, kEventLoaded, 0, slot.folder, slot.sample, (float)slot.length);
+    }
+}
+
+// Queue a sample load for the current Folder/Sample values
+// Cheap enough to call from parameterChanged(); rapid requests coalesce
+// because only the newest serial is ever served
+static void requestSampleLoad(_driftEngineAlgorithm* pThis) {
+    pThis->loadRequestSerial++;
+}
 
-        // Compute waveform overview for display
-        computeWaveformOverview(pThis->dram);
+// Issue the next chunk read of the active transfer
+// Returns true if the read was accepted
+static bool issueLoadChunk(_driftEngineAlgorithm* pThis) {
+    int32_t frames = pThis->pendingSampleLength - pThis->loadNextFrame;
+    if (frames > kLoadChunkFrames) {
+        frames = kLoadChunkFrames;
+    }
+
+    SampleSlot& slot = pThis->engine.dram->slots[pThis->loadSlot];
+    if (pThis->loadResampling) {
+        // Native-rate frames land after the history, converted in the callback
+        pThis->wavRequest.dst = pThis->engine.dram->resampleStaging + kResampleTaps;
+    } else if (slot.packed) {
+        pThis->wavRequest.dst = slot.packed + pThis->loadNextFrame;
+    } else {
+        pThis->wavRequest.dst = slot.frames + pThis->loadNextFrame;
     }
+    pThis->wavRequest.numFrames = frames;
+    pThis->wavRequest.startOffset = pThis->loadNextFrame;
+
+    // Advance before the read - the callback may fire before it returns
+    pThis->loadChunkLength = frames;
+    pThis->loadChunkFailed = false;
+    pThis->awaitingCallback = true;
+    pThis->loadNextFrame += frames;
+    if (NT_readSampleFrames(pThis->wavRequest)) {
+        return true;
+    }
+
+    // Not accepted - retry this chunk on a later step
+    pThis->awaitingCallback = false;
+    pThis->loadNextFrame -= frames;
+    return false;
 }
 
 // Helper to initiate sample loading (like sample player example)
@@ -845,84 +723,117 @@ static bool loadSample(_driftEngineAlgorithm* pThis) {
         return false;
     }
 
-    // Limit to our buffer size
+    _driftEngine_DRAM* dram = pThis->engine.dram;
+    int slotIndex = chooseVictimSlot(dram);
+    SampleSlot& slot = dram->slots[slotIndex];
+
+    // Resample when a storage rate is set and the file differs from it
+    float sourceRate = (float)info.sampleRate;
+    pThis->loadResampling = dram->storageRate > 0 && sourceRate != dram->storageRate;
+
+    // Limit to our slot size (in stored frames)
     uint32_t framesToRead = info.numFrames;
-    if (framesToRead > kMaxSampleFrames) {
-        framesToRead = kMaxSampleFrames;
+    if (pThis->loadResampling) {
+        double step = sourceRate / dram->storageRate;
+        double outFrames = (framesToRead - 1) / step + 1;
+        if (outFrames > slot.capacity) {
+            outFrames = slot.capacity;
+            framesToRead = (uint32_t)(outFrames * step);
+        }
+        pThis->resampleStep = step;
+        pThis->resampleInBase = 0;
+        pThis->resampleOutFrames = 0;
+        pThis->resampleOutTotal = (int32_t)outFrames;
+        memset(dram->resampleStaging, 0, kResampleTaps * sizeof(float));
+        buildResampleKernel(dram, sourceRate, dram->storageRate);
+    } else if (framesToRead > (uint32_t)slot.capacity) {
+        framesToRead = slot.capacity;
+    }
+
+    // Evict the previous occupant. A playing slot (single-slot cache) keeps
+    // its length so the old sample plays on until the new one is ready, but
+    // not its maps - the new file streams over the audio they describe, so
+    // grains fall back to searching the frames directly until it is analysed
+    slot.folder = -1;
+    slot.sample = -1;
+    slot.maps.generation++;
+    slot.maps.jobsPosted = 0;
+    slot.maps.numFeatureBins = 0;
+    slot.maps.numZeroCrossBlocks = 0;
+    slot.maps.numPitchBins = 0;
+    if (slotIndex != dram->activeSlot) {
+        slot.length = 0;
     }
 
     // Store pending values - will be applied in callback when load completes
-    // This keeps the old sample playing until the new one is ready
+    pThis->loadSlot = slotIndex;
     pThis->pendingSampleLength = framesToRead;
-    pThis->pendingSourceSampleRate = (float)info.sampleRate;
-    pThis->dram->sampleIsStereo = (info.channels == kNT_WavStereo);
+    pThis->pendingSourceSampleRate = sourceRate;
+    pThis->loadNextFrame = 0;
 
     // Prepare the request (like sample player example)
     // Always request mono - the granular engine adds stereo spread via panning
     pThis->wavRequest.folder = folder;
     pThis->wavRequest.sample = sample;
-    pThis->wavRequest.dst = pThis->dram->sampleBufferL;
-    pThis->wavRequest.numFrames = framesToRead;
-    pThis->wavRequest.startOffset = 0;
     pThis->wavRequest.channels = kNT_WavMono;    // Always mono (API will sum stereo)
-    pThis->wavRequest.bits = kNT_WavBits32;      // Convert to float
+    pThis->wavRequest.bits = (slot.packed && !pThis->loadResampling) ? kNT_WavBits16 : kNT_WavBits32;
     pThis->wavRequest.progress = kNT_WavProgress;
     pThis->wavRequest.callback = wavLoadCallback;
     pThis->wavRequest.callbackData = pThis;
 
-    if (NT_readSampleFrames(pThis->wavRequest)) {
-        pThis->awaitingCallback = true;
-        return true;
+    return issueLoadChunk(pThis);
+}
+
+// Advance the load queue (called once per step)
+// Cached samples are switched to at once, with no I/O, even mid-transfer.
+// Otherwise a chunk in flight owns its slot, so decisions are only made between
+// chunks: stale or failed transfers are abandoned and the newest request starts
+static void serviceSampleLoads(_driftEngineAlgorithm* pThis) {
+    if (pThis->loadServedSerial != pThis->loadRequestSerial && pThis->initialized) {
+        int cached = findCachedSample(pThis->engine.dram, pThis->v[kParamFolder], pThis->v[kParamSample]);
+        if (cached >= 0) {
+            activateSlot(pThis->engine.dram, cached);
+            pThis->loadServedSerial = pThis->loadRequestSerial;
+            SESSION_EVENT(pThis, kEventCached, 0, pThis->v[kParamFolder], pThis->v[kParamSample]);
+        }
+    }
+
+    if (pThis->awaitingCallback) return;
+
+    if (pThis->loadActive) {
+        bool stale = pThis->loadTransferSerial != pThis->loadRequestSerial;
+        bool finished = pThis->loadNextFrame >= pThis->pendingSampleLength;
+        if (!stale && !pThis->loadChunkFailed && !finished) {
+            issueLoadChunk(pThis);
+            return;
+        }
+        pThis->loadActive = false;
+    }
+
+    if (pThis->loadServedSerial != pThis->loadRequestSerial) {
+        // Claim the newest request up front so its callbacks count as current
+        uint32_t previous = pThis->loadServedSerial;
+        pThis->loadServedSerial = pThis->loadRequestSerial;
+        pThis->loadTransferSerial = pThis->loadRequestSerial;
+        pThis->loadActive = true;
+        if (!loadSample(pThis)) {
+            // Only mark served if load actually started
+            pThis->loadServedSerial = previous;
+            pThis->loadActive = false;
+        } else {
+            SESSION_EVENT(pThis, kEventLoad, 0, pThis->wavRequest.folder, pThis->wavRequest.sample,
+                          (float)pThis->pendingSampleLength);
+        }
     }
-    return false;
 }
 
 _NT_algorithm* construct(const _NT_algorithmMemoryPtrs& ptrs,
                          const _NT_algorithmRequirements& req,
                          const int32_t* specifications) {
-    _driftEngine_DTC* dtc = (_driftEngine_DTC*)ptrs.dtc;
-    _driftEngine_DRAM* dram = (_driftEngine_DRAM*)ptrs.dram;
-
-    // Initialize DTC
-    memset(dtc, 0, sizeof(_driftEngine_DTC));
-    dtc->randState = 0x12345678;  // Seed
-    dtc->smoothNorm = 1.0f;       // Start at unity gain
-
-    // Initialize smoothed values to defaults (avoid boundary collapse during ramp-up)
-    dtc->anchorSmooth = 0.5f;     // Match default anchor (50%)
-    dtc->driftSmooth = 0.3f;      // Match default drift (30%)
-    dtc->densitySmooth = 8.0f;    // Match densityToRate(50)
-    dtc->entropySmooth = 0.25f;   // Match default entropy (25%)
-
-    // Initialize crossfade state (50ms at 48kHz = 2400 samples)
-    dtc->crossfadeActive = false;
-    dtc->crossfadeSamples = 0.05f * 48000.0f;  // Will be updated with actual sample rate
-    dtc->crossfadeCounter = 0;
-    dtc->sampleModeGain = 1.0f;  // Start with sample mode active
-    dtc->liveModeGain = 0.0f;
-
-    // Initialize drifters with spread positions
-    for (int i = 0; i < kNumDrifters; i++) {
-        dtc->drifters[i].position = 0.25f + i * 0.15f;  // Spread across sample
-        dtc->drifters[i].velocity = 0;
-        dtc->drifters[i].pitchOffset = 0;
-        dtc->drifters[i].timeSinceGrain = 0;
-        dtc->drifters[i].nextGrainTime = randFloat(dtc) * 0.5f;  // Stagger initial grains
-        dtc->drifters[i].variation = 0.5f + randFloat(dtc) * 0.5f;  // 0.5-1.0, set once
-        dtc->drifters[i].driftDirection = (i % 2 == 0) ? 1.0f : -1.0f;  // Alternate directions
-        dtc->drifters[i].boredom = 0;
-        dtc->drifters[i].lastSignificantPos = dtc->drifters[i].position;
-    }
-
-    // Initialize DRAM
-    memset(dram->sampleBufferL, 0, sizeof(dram->sampleBufferL));
-    memset(dram->sampleBufferR, 0, sizeof(dram->sampleBufferR));
-    dram->sampleLength = 0;
-    dram->sampleLoaded = false;
-    dram->sampleIsStereo = false;
-
-    // Create algorithm
-    _driftEngineAlgorithm* alg = new (ptrs.sram) _driftEngineAlgorithm(dtc, dram);
+    // Create algorithm, and the engine in the DTC and DRAM
+    _driftEngineAlgorithm* alg = new (ptrs.sram) _driftEngineAlgorithm();
+    engineInit(&alg->engine, ptrs.dtc, ptrs.dram, engineConfigForSpec(specifications));
+    alg->liveParamsShown = false;
 
     // Copy parameters to mutable array (like sample player example)
     memcpy(alg->params, parameters, sizeof(parameters));
@@ -933,10 +844,21 @@ _NT_algorithm* construct(const _NT_algorithmMemoryPtrs& ptrs,
     alg->cardMounted = false;
     alg->awaitingCallback = false;
     alg->initialized = false;
-    alg->pendingSampleLoad = false;
+    alg->loadRequestSerial = 0;
+    alg->loadServedSerial = 0;
+    alg->loadTransferSerial = 0;
+    alg->loadActive = false;
+    alg->loadSlot = 0;
+    alg->loadChunkFailed = false;
     alg->pendingSampleLength = 0;
+    alg->loadNextFrame = 0;
+    alg->loadChunkLength = 0;
+    alg->loadResampling = false;
+    alg->resampleStep = 1.0;
+    alg->resampleInBase = 0;
+    alg->resampleOutFrames = 0;
+    alg->resampleOutTotal = 0;
     alg->pendingSourceSampleRate = 48000.0f;  // Default
-    alg->sourceSampleRate = 48000.0f;         // Default (will be updated on sample load)
 
     // Initialize soft takeover state
     // Targets start at middle - will sync on first pot movement
@@ -947,17 +869,23 @@ _NT_algorithm* construct(const _NT_algorithmMemoryPtrs& ptrs,
         alg->altTarget[i] = 0.5f;
     }
 
+#ifdef DRIFTERS_RECORD
+    sessionInit(alg->session, specifications);
+#endif
+
     // Mark as fully initialized
     alg->initialized = true;
 
-    // Mix parameter starts greyed out (Live Mode defaults to Off)
+    // Live-only parameters start greyed out (Live Mode defaults to Off)
     NT_setParameterGrayedOut(NT_algorithmIndex(alg), kParamMix + NT_parameterOffset(), true);
+    NT_setParameterGrayedOut(NT_algorithmIndex(alg), kParamMinDelay + NT_parameterOffset(), true);
 
     return alg;
 }
 
 void parameterChanged(_NT_algorithm* self, int p) {
     _driftEngineAlgorithm* pThis = (_driftEngineAlgorithm*)self;
+    SESSION_EVENT(pThis, kEventParam, p, pThis->v[p]);
 
     switch (p) {
         case kParamFolder: {
@@ -972,20 +900,25 @@ void parameterChanged(_NT_algorithm* self, int p) {
         }
         case kParamSample:
             // Request sample load (deferred to step() for safety)
-            pThis->pendingSampleLoad = true;
+            // Rapid changes coalesce - only the newest selection is loaded
+            requestSampleLoad(pThis);
             break;
         // All other parameters are read directly from pThis->v[] in step()
     }
 }
 
+// Bus parameters count from 1; 0 means "None"
+static inline float* busOrNull(float* busFrames, int bus, int numFrames) {
+    return (bus > 0) ? busFrames + (bus - 1) * numFrames : NULL;
+}
+
 void step(_NT_algorithm* self, float* busFrames, int numFramesBy4) {
     _driftEngineAlgorithm* pThis = (_driftEngineAlgorithm*)self;
-    _driftEngine_DTC* dtc = pThis->dtc;
-    _driftEngine_DRAM* dram = pThis->dram;
-
+    const int16_t* v = pThis->v;
     int numFrames = numFramesBy4 * 4;
-    float sr = NT_globals.sampleRate;
-    float dt = 1.0f / sr;
+#ifdef DRIFTERS_RECORD
+    sessionBeginBlock(pThis->session, pThis->v, busFrames, numFrames);
+#endif
 
     // Check for SD card mount/unmount
     bool cardMounted = NT_isSdCardMounted();
@@ -1004,568 +937,144 @@ void step(_NT_algorithm* self, float* busFrames, int numFramesBy4) {
 #ifdef DISTING_HARDWARE
             NT_updateParameterDefinition(NT_algorithmIndex(self), kParamSample);
 #endif
-            // Request sample load (handled via pendingSampleLoad below)
-            pThis->pendingSampleLoad = true;
+            // Request sample load (handled by the load queue below)
+            requestSampleLoad(pThis);
         } else {
-            // Card unmounted - DON'T clear sampleLoaded!
-            // Keep playing whatever was loaded (test tone or previously loaded sample)
-            // Only clear pending load state
-            pThis->pendingSampleLoad = false;
-            pThis->awaitingCallback = false;
+            // Card unmounted - keep playing whatever is already cached
+            // Drop queued load state. A chunk in flight still owns its buffer
+            // until its callback arrives, so leave awaitingCallback set and
+            // just make the transfer stale - the callback then applies nothing
+            pThis->loadServedSerial = pThis->loadRequestSerial;
+            pThis->loadTransferSerial = pThis->loadRequestSerial - 1;
+            pThis->loadActive = false;
         }
     }
 
     // Handle deferred sample load requests
-    if (pThis->pendingSampleLoad && !pThis->awaitingCallback) {
-        if (loadSample(pThis)) {
-            pThis->pendingSampleLoad = false;  // Only clear if load actually started
-        }
-    }
-
-    // Get output busses
-    float* outL = busFrames + (pThis->v[kParamOutputL] - 1) * numFrames;
-    float* outR = busFrames + (pThis->v[kParamOutputR] - 1) * numFrames;
-    bool replaceL = pThis->v[kParamOutputLMode];
-    bool replaceR = pThis->v[kParamOutputRMode];
-
-    // Get CV inputs (only if assigned - value 0 means "None")
-    const float* cvAnchor = (pThis->v[kParamCvAnchor] > 0) ? busFrames + (pThis->v[kParamCvAnchor] - 1) * numFrames : NULL;
-    const float* cvPitch = (pThis->v[kParamCvPitch] > 0) ? busFrames + (pThis->v[kParamCvPitch] - 1) * numFrames : NULL;
-    const float* cvDrift = (pThis->v[kParamCvDrift] > 0) ? busFrames + (pThis->v[kParamCvDrift] - 1) * numFrames : NULL;
-    const float* cvEntropy = (pThis->v[kParamCvEntropy] > 0) ? busFrames + (pThis->v[kParamCvEntropy] - 1) * numFrames : NULL;
-    const float* cvStorm = (pThis->v[kParamCvStorm] > 0) ? busFrames + (pThis->v[kParamCvStorm] - 1) * numFrames : NULL;
-    const float* cvClock = (pThis->v[kParamCvClock] > 0) ? busFrames + (pThis->v[kParamCvClock] - 1) * numFrames : NULL;
+    serviceSampleLoads(pThis);
 
-    // Get CV outputs (mode params exist but we always use replace to avoid accumulation)
-    float* cvOutPos = busFrames + (pThis->v[kParamCvOutPosition] - 1) * numFrames;
-    float* cvOutPulse = busFrames + (pThis->v[kParamCvOutPulse] - 1) * numFrames;
-
-    // Live Mode parameters
-    bool liveMode = pThis->v[kParamLiveMode] != 0;
-    int inputBusL = pThis->v[kParamInputL];
-    int inputBusR = pThis->v[kParamInputR];
-    bool freezeGate = pThis->v[kParamFreeze] != 0;
-
-    // Get audio inputs for Live Mode (user-selected buses)
-    const float* inputL = (inputBusL > 0) ? busFrames + (inputBusL - 1) * numFrames : NULL;
-    const float* inputR = (inputBusR > 0) ? busFrames + (inputBusR - 1) * numFrames : NULL;
-
-    // Handle freeze state
-    if (freezeGate && !dtc->frozen) {
-        dtc->frozen = true;
-    } else if (!freezeGate && dtc->frozen) {
-        dtc->frozen = false;
-    }
-
-    // Update crossfade duration for actual sample rate
-    dtc->crossfadeSamples = 0.05f * sr;  // 50ms crossfade
-
-    // Detect mode change and start crossfade
-    if (liveMode != dtc->prevLiveMode) {
-        dtc->crossfadeActive = true;
-        dtc->crossfadeCounter = 0;
-
-        // When leaving Live Mode (and not frozen), reload the sample
-        if (!liveMode && !dtc->frozen) {
-            pThis->pendingSampleLoad = true;
-        }
-
-        // Grey out Mix parameter when not in Live Mode
+    // Grey out live-only parameters when not in Live Mode
+    bool liveMode = v[kParamLiveMode] != 0;
+    if (liveMode != pThis->liveParamsShown) {
         NT_setParameterGrayedOut(NT_algorithmIndex(pThis), kParamMix + NT_parameterOffset(), !liveMode);
-
-        dtc->prevLiveMode = liveMode;
+        NT_setParameterGrayedOut(NT_algorithmIndex(pThis), kParamMinDelay + NT_parameterOffset(), !liveMode);
+        pThis->liveParamsShown = liveMode;
     }
 
-    // Update crossfade gains (block-rate update for efficiency)
-    if (dtc->crossfadeActive) {
-        float fadeProgress = dtc->crossfadeCounter / dtc->crossfadeSamples;
-        fadeProgress = fminf(fadeProgress, 1.0f);
-
-        if (liveMode) {
-            // Transitioning TO Live Mode: sample fades out, live fades in
-            dtc->sampleModeGain = 1.0f - fadeProgress;
-            dtc->liveModeGain = fadeProgress;
-        } else {
-            // Transitioning FROM Live Mode: live fades out, sample fades in
-            dtc->sampleModeGain = fadeProgress;
-            dtc->liveModeGain = 1.0f - fadeProgress;
-        }
-
-        dtc->crossfadeCounter += numFrames;
-        if (dtc->crossfadeCounter >= dtc->crossfadeSamples) {
-            dtc->crossfadeActive = false;
-            // Set final gains
-            dtc->sampleModeGain = liveMode ? 0.0f : 1.0f;
-            dtc->liveModeGain = liveMode ? 1.0f : 0.0f;
-        }
-    }
-
-    // In Live Mode, capture audio to circular buffer
-    bool hasInput = (inputL != NULL || inputR != NULL);
-    if (liveMode && hasInput && !dtc->frozen) {
-        for (int i = 0; i < numFrames; i++) {
-            // Write to circular buffer
-            int writePos = dtc->writePointer;
-
-            // Handle stereo capture (use available input, duplicate if mono)
-            if (inputL && inputR) {
-                dram->sampleBufferL[writePos] = inputL[i];
-                dram->sampleBufferR[writePos] = inputR[i];
-            } else if (inputL) {
-                dram->sampleBufferL[writePos] = inputL[i];
-                dram->sampleBufferR[writePos] = inputL[i];
-            } else {
-                dram->sampleBufferL[writePos] = inputR[i];
-                dram->sampleBufferR[writePos] = inputR[i];
-            }
-
-            // Advance write pointer
-            dtc->writePointer = (writePos + 1) % kMaxSampleFrames;
-        }
-
-        // In Live Mode, ensure we have valid buffer settings
-        if (!dram->sampleLoaded) {
-            dram->sampleLength = kMaxSampleFrames;
-            dram->sampleLoaded = true;
-            dram->sampleIsStereo = (inputL != NULL && inputR != NULL);
-        }
-    }
+    EngineParams params;
+    params.liveMode = liveMode;
+    params.mix = v[kParamMix];
+    params.freeze = v[kParamFreeze] != 0;
+    params.minDelay = v[kParamMinDelay];
+    params.anchor = v[kParamAnchor];
+    params.wander = v[kParamWander];
+    params.gravity = v[kParamGravity];
+    params.drift = v[kParamDrift];
+    params.seek = v[kParamSeek];
+    params.density = v[kParamDensity];
+    params.deviation = v[kParamDeviation];
+    params.pitch = v[kParamPitch];
+    params.scatter = v[kParamScatter];
+    params.scale = v[kParamScale];
+    params.spectrum = v[kParamSpectrum];
+    params.tilt = v[kParamTilt];
+    params.shape = v[kParamShape];
+    params.entropy = v[kParamEntropy];
+    params.quality = v[kParamQuality];
+    params.telemetry = v[kParamTelemetry];
+
+    EngineBuffers buffers;
+    buffers.numFrames = numFrames;
+    buffers.sampleRate = NT_globals.sampleRate;
+    buffers.cvAnchor = busOrNull(busFrames, v[kParamCvAnchor], numFrames);
+    buffers.cvPitch = busOrNull(busFrames, v[kParamCvPitch], numFrames);
+    buffers.cvDrift = busOrNull(busFrames, v[kParamCvDrift], numFrames);
+    buffers.cvEntropy = busOrNull(busFrames, v[kParamCvEntropy], numFrames);
+    buffers.cvStorm = busOrNull(busFrames, v[kParamCvStorm], numFrames);
+    buffers.cvClock = busOrNull(busFrames, v[kParamCvClock], numFrames);
+    buffers.inputL = busOrNull(busFrames, v[kParamInputL], numFrames);
+    buffers.inputR = busOrNull(busFrames, v[kParamInputR], numFrames);
+    buffers.outL = busOrNull(busFrames, v[kParamOutputL], numFrames);
+    buffers.outR = busOrNull(busFrames, v[kParamOutputR], numFrames);
+    buffers.replaceL = v[kParamOutputLMode];
+    buffers.replaceR = v[kParamOutputRMode];
+    // CV outputs ignore their mode parameters - adding would accumulate every frame
+    buffers.cvOutPosition = busOrNull(busFrames, v[kParamCvOutPosition], numFrames);
+    buffers.cvOutPulse = busOrNull(busFrames, v[kParamCvOutPulse], numFrames);
+    buffers.cvOutTelemetry = busOrNull(busFrames, v[kParamCvOutTelemetry], numFrames);
+    buffers.scratch = NT_globals.workBuffer;
+    buffers.scratchBytes = NT_globals.workBufferSizeBytes;
+
+    engineRender(&pThis->engine, params, buffers);
+}
 
-    // Check if sample loaded (or Live Mode active)
-    if (!dram->sampleLoaded || dram->sampleLength < 100) {
-        // Output silence
-        for (int i = 0; i < numFrames; i++) {
-            if (replaceL) outL[i] = 0;
-            if (replaceR) outR[i] = 0;
-            cvOutPos[i] = 0;
-            cvOutPulse[i] = 0;
-        }
+#ifdef DRIFTERS_PROFILE
+// Stage breakdown of the last second: average per block and share of the
+// total for each stage, then the worst block and the stage that led it
+static void drawProfile(const StageProfile& p) {
+    char text[16];
+    NT_drawText(10, 10, "PROFILE", 15, kNT_textLeft, kNT_textNormal);
+    NT_drawText(100, 10, "per block", 10, kNT_textLeft, kNT_textTiny);
+    NT_drawText(140, 10, kProfileUnit, 10, kNT_textLeft, kNT_textTiny);
+    if (p.shownBlocks == 0) {
+        NT_drawText(10, 30, "Measuring...", 10, kNT_textLeft, kNT_textTiny);
         return;
     }
 
-    float sampleLen = (float)dram->sampleLength;
-
-    // Process each sample
-    for (int frame = 0; frame < numFrames; frame++) {
-        // Read CV modulation (sample at audio rate, check for NULL)
-        float anchorMod = cvAnchor ? cvAnchor[frame] * 0.1f : 0;  // ±5V = ±0.5 (50%)
-        float pitchMod = cvPitch ? cvPitch[frame] * 12.0f : 0;  // 1V/oct
-        float driftMod = cvDrift ? 1.0f + cvDrift[frame] * 0.2f : 1.0f;  // ±5V = ±100%
-        float entropyMod = cvEntropy ? fmaxf(0, cvEntropy[frame] * 0.2f) : 0;  // 0-5V = 0-100%
-        float stormGate = cvStorm ? cvStorm[frame] > 1.0f : false;  // Gate threshold
-        float clockIn = cvClock ? cvClock[frame] : 0;
-
-        // Smooth parameters (read directly from v[])
-        float smoothRate = 0.001f;
-        float anchorTarget = pThis->v[kParamAnchor] / 100.0f;
-        float driftSpeed = pThis->v[kParamDrift] / 100.0f;
-        float densityRate = densityToRate((float)pThis->v[kParamDensity]);
-        dtc->anchorSmooth += (anchorTarget + anchorMod - dtc->anchorSmooth) * smoothRate;
-        dtc->driftSmooth += (driftSpeed * driftMod - dtc->driftSmooth) * smoothRate;
-        dtc->densitySmooth += (densityRate - dtc->densitySmooth) * smoothRate;
-
-        // Entropy with CV and storm
-        float targetEntropy = pThis->v[kParamEntropy] / 100.0f + entropyMod;
-        if (stormGate) {
-            dtc->stormLevel = 1.0f;  // Instant max
-        } else {
-            dtc->stormLevel *= 0.9999f;  // Slow decay (~5-10 seconds)
-        }
-        float effectiveEntropy = fminf(1.0f, targetEntropy + dtc->stormLevel);
-        dtc->entropySmooth += (effectiveEntropy - dtc->entropySmooth) * smoothRate;
-
-        // Clock detection
-        bool clockEdge = false;
-        if (clockIn > 1.0f && dtc->prevClock <= 1.0f) {
-            // Rising edge
-            clockEdge = true;
-            if (dtc->clockReceived) {
-                // Calculate period from last clock
-                dtc->clockPeriod = 1.0f / dtc->clockPhase;  // Period in seconds
-            }
-            dtc->clockPhase = 0;
-            dtc->clockReceived = true;
-        }
-        dtc->prevClock = clockIn;
-        if (dtc->clockReceived) {
-            dtc->clockPhase += dt;
-        }
-
-        // ====== UPDATE DRIFTERS ======
-        float anchor = fmaxf(0, fminf(1, dtc->anchorSmooth));
-        float wander = pThis->v[kParamWander] / 100.0f;
-        float gravity = pThis->v[kParamGravity] / 100.0f;
-        float drift = dtc->driftSmooth;
-        float entropy = dtc->entropySmooth;
-
-        float avgPos = 0;
-
-        for (int d = 0; d < kNumDrifters; d++) {
-            Drifter& drifter = dtc->drifters[d];
-
-            // Calculate gravity force toward/away from anchor
-            float dist = drifter.position - anchor;
-            float gravityAccel = -gravity * dist * 100.0f;  // Toward anchor when positive
-
-            // Calculate repulsion from other drifters (only when close)
-            // Repulsion is reduced by boredom - bored drifters can pass each other
-            float repulsion = 0;
-            const float repulsionThreshold = 0.05f;  // Only repel within 5% of sample
-            for (int other = 0; other < kNumDrifters; other++) {
-                if (other == d) continue;
-                float diff = drifter.position - dtc->drifters[other].position;
-                float absDiff = fabsf(diff);
-                // Only apply repulsion when within threshold distance
-                if (absDiff < repulsionThreshold && absDiff > 0.001f) {
-                    // Inversely proportional to distance (stronger when closer)
-                    float strength = 0.00001f / absDiff;
-                    repulsion += (diff > 0 ? 1.0f : -1.0f) * strength;
-                }
-            }
-            // Scale repulsion by (1 - boredom): bored drifters are attracted to pass
-            repulsion *= (1.0f - drifter.boredom * 1.05f);  // -5% at full boredom
-
-            // Random walk based on entropy
-            float randomWalk = randFloatBipolar(dtc) * entropy * 0.01f;
-
-            // Update velocity
-            drifter.velocity += gravityAccel * dt;
-            drifter.velocity += repulsion;  // Add repulsion force
-            drifter.velocity += randomWalk;
-            drifter.velocity *= 0.995f;  // Slightly less aggressive damping
-
-            // Base drift speed - uses stored variation and BIDIRECTIONAL direction
-            // Scale by dt so drift is time-based, not sample-rate dependent
-            // 0.05 gives ~1% per second at 30% drift - slow ambient movement
-            float baseDrift = drift * drifter.variation * drifter.driftDirection * dt * 0.05f;
-
-            // Update position
-            drifter.position += drifter.velocity * dt + baseDrift;
-
-            // Constrain to wander range around anchor
-            float minPos = anchor - wander;
-            float maxPos = anchor + wander;
-
-            // Soft boundaries with bounce - reverse drift direction on hit
-            if (drifter.position < minPos) {
-                drifter.position = minPos + (minPos - drifter.position) * 0.5f;
-                drifter.velocity = fabsf(drifter.velocity) * 0.5f;
-                drifter.driftDirection = 1.0f;  // Now drift right
-            }
-            if (drifter.position > maxPos) {
-                drifter.position = maxPos - (drifter.position - maxPos) * 0.5f;
-                drifter.velocity = -fabsf(drifter.velocity) * 0.5f;
-                drifter.driftDirection = -1.0f;  // Now drift left
-            }
-
-
-            // Hard clamp
-            drifter.position = fmaxf(0.001f, fminf(0.999f, drifter.position));
-
-            // Update boredom: builds up when staying in same region, resets on movement
-            const float boredomMovementThreshold = 0.03f;  // 3% movement resets boredom
-            const float boredomBuildRate = 0.05f;          // Time to full boredom ~20 sec
-            float movementFromHome = fabsf(drifter.position - drifter.lastSignificantPos);
-            if (movementFromHome > boredomMovementThreshold) {
-                // Moved significantly - reset boredom and update home
-                drifter.boredom = 0;
-                drifter.lastSignificantPos = drifter.position;
-            } else {
-                // Staying in same region - slowly increase boredom
-                drifter.boredom = fminf(1.0f, drifter.boredom + boredomBuildRate * dt);
-            }
-
-            avgPos += drifter.position;
-
-            // ====== GRAIN TRIGGERING ======
-            drifter.timeSinceGrain += dt;
-
-            // Determine if we should trigger a grain
-            bool shouldTrigger = false;
-            float deviation = pThis->v[kParamDeviation] / 100.0f;
-
-            if (dtc->clockReceived && deviation < 1.0f) {
-                // Clock sync mode
-                if (deviation == 0.0f) {
-                    // Pure clock sync: only trigger on clock edges
-                    // Each drifter triggers on clock (could add phase offsets later)
-                    shouldTrigger = clockEdge;
-                } else {
-                    // Blended mode: clock edges always trigger, plus some Poisson triggers
-                    // The lower the deviation, the fewer random triggers
-                    if (clockEdge) {
-                        shouldTrigger = true;
-                    } else if (drifter.timeSinceGrain >= drifter.nextGrainTime) {
-                        // Random trigger with probability based on deviation
-                        shouldTrigger = (randFloat(dtc) < deviation);
-                    }
-                }
-            } else {
-                // Free-running Poisson mode
-                shouldTrigger = (drifter.timeSinceGrain >= drifter.nextGrainTime);
-            }
-
-            if (shouldTrigger) {
-                // Trigger new grain
-                drifter.timeSinceGrain = 0;
-
-                // Calculate lambda for NEXT grain interval
-                float lambda = dtc->densitySmooth;
-
-                // Add entropy-based jitter to rate
-                lambda *= 1.0f + randFloatBipolar(dtc) * entropy * 0.5f;
-
-                drifter.nextGrainTime = randExponential(dtc, lambda);
-
-                // Find free grain slot
-                for (int g = 0; g < kMaxTotalGrains; g++) {
-                    if (!dtc->grains[g].active) {
-                        Grain& grain = dtc->grains[g];
-                        grain.active = true;
-
-                        // Calculate grain start position
-                        int rawPos;
-                        if (liveMode) {
-                            // In Live Mode: position is relative to write head (behind it)
-                            // This keeps drifters always in the safe "past" area of the buffer
-                            int safeDistance = 256;  // Minimum distance behind write head
-                            int maxDistance = (int)sampleLen - safeDistance * 2;
-                            int offsetBehind = safeDistance + (int)(drifter.position * maxDistance);
-                            rawPos = (dtc->writePointer - offsetBehind + (int)sampleLen) % (int)sampleLen;
-                            // Skip zero-crossing search in Live Mode (buffer constantly changing)
-                            grain.position = (float)rawPos;
-                        } else {
-                            // Sample mode: absolute position with zero-crossing snap
-                            rawPos = (int)(drifter.position * sampleLen);
-                            grain.position = (float)findNearestZeroCrossing(dram->sampleBufferL, rawPos, dram->sampleLength, 256);
-                        }
-                        grain.phase = 0;
-                        float grainSize = densityToSize((float)pThis->v[kParamDensity]) * sr;
-                        grain.phaseDelta = 1.0f / grainSize;
-                        grain.drifterIndex = d;
-                        grain.shape = (GrainShape)pThis->v[kParamShape];
-                        grain.amplitude = 1.0f;  // Base amplitude (soft clipping handles overload)
-
-                        int scaleIndex = pThis->v[kParamScale];
-
-                        // In Live Mode with scale: detect source pitch and quantize to stay in scale
-                        float detectedPitch = 0.0f;
-                        if (liveMode && scaleIndex > 0) {
-                            detectedPitch = detectPitch(dram->sampleBufferL, rawPos, dram->sampleLength, sr);
-                        }
-
-                        float pitchSemis;
-
-                        if (scaleIndex == 0) {
-                            pitchSemis = (float)pThis->v[kParamPitch] + pitchMod;
-
-                            float scatterDir = (d == 0 || d == 3) ? 1.0f : -1.0f;
-                            float scatterMagnitude = (d == 0 || d == 3) ? fabsf(d - 1.5f) : fabsf(d - 1.5f);
-                            pitchSemis += (float)pThis->v[kParamScatter] * scatterDir * (scatterMagnitude / 1.5f);
-
-                            pitchSemis += randFloatBipolar(dtc) * entropy * 2.0f;
-                        } else {
-                            float basePitch = (float)pThis->v[kParamPitch];
-
-                            // In Live Mode: use detected pitch as reference, quantize to scale
-                            if (liveMode && detectedPitch != 0.0f) {
-                                // Quantize detected pitch to scale, use that as base
-                                basePitch += quantizePitchToScale(detectedPitch, scaleIndex) - detectedPitch;
-                            }
-
-                            if (pitchMod != 0.0f) {
-                                basePitch += quantizePitchToScale(pitchMod, scaleIndex);
-                            }
-
-                            float scatterDir = (d == 0 || d == 3) ? 1.0f : -1.0f;
-                            float scatterMagnitude = (d == 0 || d == 3) ? fabsf(d - 1.5f) : fabsf(d - 1.5f);
-                            int scatterDegrees = (int)roundf((float)pThis->v[kParamScatter] * scatterDir * (scatterMagnitude / 1.5f));
-
-                            float scatterSemis = degreeToSemitones(scatterDegrees, scaleIndex);
-                            pitchSemis = basePitch + scatterSemis;
-
-                            // Entropy adds random scale degrees, biased toward characteristic notes
-                            if (entropy > 0.01f) {
-                                int maxDegrees = (int)(entropy * 4.0f);  // 0-4 degrees based on entropy
-                                if (maxDegrees > 0) {
-                                    int jitterDegree = getCharacteristicDegree(dtc, scaleIndex, maxDegrees);
-                                    pitchSemis += degreeToSemitones(jitterDegree, scaleIndex);
-                                }
-                            }
-                        }
-
-                        // Include sample rate ratio for proper playback speed
-                        // Calculate sample rate ratio on the fly (handles NT sample rate changes)
-                        float sampleRateRatio = pThis->sourceSampleRate / sr;
-                        grain.positionDelta = powf(2.0f, pitchSemis / 12.0f) * sampleRateRatio;
-
-                        // Don't reset filters - let state carry over to avoid transients
-                        // grain.filterL.reset();
-                        // grain.filterR.reset();
-
-                        // Pulse output trigger
-                        dtc->pulseOut = true;
-
-                        break;
-                    }
-                }
-            }
-        }
-
-        dtc->averagePosition = avgPos / kNumDrifters;
-
-        // ====== RENDER GRAINS ======
-        float mixL = 0;
-        float mixR = 0;
-        int activeGrains = 0;
-
-        for (int g = 0; g < kMaxTotalGrains; g++) {
-            Grain& grain = dtc->grains[g];
-            if (!grain.active) continue;
-            activeGrains++;
-
-            // CPU protection: skip rendering if we've hit the limit
-            if (activeGrains > kMaxActiveGrains) continue;
-
-            // Read sample with linear interpolation
-            int pos0 = (int)grain.position;
-            int pos1 = pos0 + 1;
-            float frac = grain.position - pos0;
-
-            // Wrap positions
-            pos0 = pos0 % dram->sampleLength;
-            pos1 = pos1 % dram->sampleLength;
-            if (pos0 < 0) pos0 += dram->sampleLength;
-            if (pos1 < 0) pos1 += dram->sampleLength;
-
-            // In Live Mode, fade out grains approaching the write head
-            float liveProximityFade = 1.0f;
-            if (liveMode) {
-                const int dangerZone = 128;   // Hard cutoff
-                const int fadeZone = 512;     // Start fading here
-                int writePos = dtc->writePointer;
-                int len = dram->sampleLength;
-
-                int distBehind = (writePos - pos0 + len) % len;
-                int distAhead = (pos0 - writePos + len) % len;
-                int minDist = (distBehind < distAhead) ? distBehind : distAhead;
-
-                if (minDist < dangerZone) {
-                    // Too close - skip this grain entirely
-                    continue;
-                } else if (minDist < fadeZone) {
-                    // In fade zone - smoothly reduce volume
-                    liveProximityFade = (float)(minDist - dangerZone) / (float)(fadeZone - dangerZone);
-                }
-            }
-
-            // Read sample - stereo in Live Mode, mono for sample playback
-            float sampleL, sampleR;
-            if (liveMode && dram->sampleIsStereo) {
-                // True stereo reading from both buffers
-                sampleL = dram->sampleBufferL[pos0] * (1 - frac) + dram->sampleBufferL[pos1] * frac;
-                sampleR = dram->sampleBufferR[pos0] * (1 - frac) + dram->sampleBufferR[pos1] * frac;
-            } else {
-                // Mono reading (existing behavior)
-                float sampleMono = dram->sampleBufferL[pos0] * (1 - frac) + dram->sampleBufferL[pos1] * frac;
-                sampleL = sampleMono;
-                sampleR = sampleMono;
-            }
-
-            // Apply grain envelope (with proximity fade in Live Mode)
-            float env = grainEnvelope(grain.phase, grain.shape) * liveProximityFade;
-            sampleL *= env * grain.amplitude;
-            sampleR *= env * grain.amplitude;
-
-            // Apply filter bank separation (spectrum parameter)
-            int d = grain.drifterIndex;
-
-            float spectrumSep = pThis->v[kParamSpectrum] / 100.0f;
-            if (spectrumSep > 0.01f) {
-                float filterFreq = kBandCenterFreqs[d];
-                float filterQ = 1.0f + spectrumSep * 2.0f;  // Q from 1 to 3
-                sampleL = grain.filterL.process(sampleL, filterFreq, filterQ, sr) * (1.0f + spectrumSep);
-                sampleR = grain.filterR.process(sampleR, filterFreq, filterQ, sr) * (1.0f + spectrumSep);
-            }
-
-            // Apply tilt (per-drifter volume)
-            float tiltAmount = pThis->v[kParamTilt] / 100.0f;
-            float tiltVol = tiltVolume(d, tiltAmount);
-            sampleL *= tiltVol;
-            sampleR *= tiltVol;
-
-            // Apply stereo panning based on drifter position relative to anchor
-            // Left of anchor = left pan, right of anchor = right pan
-            float drifterPos = dtc->drifters[d].position;
-            float pan = (wander > 0.01f) ? (drifterPos - anchor) / wander : 0;
-            pan = fmaxf(-1.0f, fminf(1.0f, pan));  // Clamp to -1..+1
-            // Linear crossfade panning (cheap, sounds fine for ambient)
-            float panL = 0.5f - pan * 0.5f;
-            float panR = 0.5f + pan * 0.5f;
-            mixL += sampleL * panL + sampleR * (1.0f - panL);
-            mixR += sampleL * (1.0f - panR) + sampleR * panR;
-
-            // Advance grain
-            grain.position += grain.positionDelta;
-            grain.phase += grain.phaseDelta;
-
-            // Wrap position
-            while (grain.position >= sampleLen) grain.position -= sampleLen;
-            while (grain.position < 0) grain.position += sampleLen;
-
-            // Check if grain finished
-            if (grain.phase >= 1.0f) {
-                grain.active = false;
-            }
-        }
-
-        // Normalize by grain count to prevent saturation (sqrt for density perception)
-        // Smooth the normalization factor to prevent clicks from sudden grain count changes
-        float targetNorm = (activeGrains > 1) ? 1.0f / sqrtf((float)activeGrains) : 1.0f;
-        dtc->smoothNorm += 0.001f * (targetNorm - dtc->smoothNorm);  // Very slow smoothing
-        if (dtc->smoothNorm < 0.1f) dtc->smoothNorm = 0.1f;  // Prevent divide issues
-        mixL *= dtc->smoothNorm;
-        mixR *= dtc->smoothNorm;
-
-        // Apply mode crossfade gain during transitions
-        // Use the gain for the current mode (smooth fade during switch)
-        float modeGain = liveMode ? dtc->liveModeGain : dtc->sampleModeGain;
-        mixL *= modeGain;
-        mixR *= modeGain;
-
-        // In Live Mode: apply wet/dry mix (100% = full wet/grains, 0% = full dry/input)
-        if (liveMode && inputL && inputR) {
-            float wet = pThis->v[kParamMix] / 100.0f;
-            float dry = 1.0f - wet;
-            mixL = mixL * wet + inputL[frame] * dry;
-            mixR = mixR * wet + inputR[frame] * dry;
-        }
-
-        // Soft clipping with Eurorack-level output (±5V)
-        mixL = tanhf(mixL * 2.0f) * 5.0f;
-        mixR = tanhf(mixR * 2.0f) * 5.0f;
-
-        // NaN/Inf protection
-        if (mixL != mixL || mixL > 1e10f || mixL < -1e10f) mixL = 0;
-        if (mixR != mixR || mixR > 1e10f || mixR < -1e10f) mixR = 0;
-
-        // Output audio
-        if (replaceL) outL[frame] = mixL;
-        else outL[frame] += mixL;
-        if (replaceR) outR[frame] = mixR;
-        else outR[frame] += mixR;
+    uint64_t sum = 0;
+    for (int s = 0; s < kNumStages; s++) sum += p.shownTotal[s];
+    if (sum == 0) sum = 1;
+
+    for (int s = 0; s < kNumStages; s++) {
+        int x = (s < 4) ? 10 : 130;
+        int y = 22 + (s % 4) * 8;
+        NT_drawText(x, y, stageNames[s], 10, kNT_textLeft, kNT_textTiny);
+        NT_intToString(text, (int32_t)(p.shownTotal[s] / p.shownBlocks));
+        NT_drawText(x + 75, y, text, 15, kNT_textRight, kNT_textTiny);
+        int percent = (int)(p.shownTotal[s] * 100 / sum);
+        NT_intToString(text, percent);
+        NT_drawText(x + 100, y, text, 12, kNT_textRight, kNT_textTiny);
+        NT_drawText(x + 101, y, "%", 10, kNT_textLeft, kNT_textTiny);
+    }
 
-        // CV outputs (always replace - add mode would accumulate values each frame)
-        cvOutPos[frame] = dtc->averagePosition * 5.0f;  // 0-5V
-        cvOutPulse[frame] = dtc->pulseOut ? 5.0f : 0;
-        dtc->pulseOut = false;
+    int worstStage = 0;
+    for (int s = 1; s < kNumStages; s++) {
+        if (p.shownWorstStages[s] > p.shownWorstStages[worstStage]) worstStage = s;
     }
+    NT_drawText(10, 58, "Worst", 10, kNT_textLeft, kNT_textTiny);
+    NT_intToString(text, (int32_t)p.shownWorst);
+    NT_drawText(75, 58, text, 15, kNT_textRight, kNT_textTiny);
+    NT_drawText(80, 58, stageNames[worstStage], 12, kNT_textLeft, kNT_textTiny);
+    NT_intToString(text, (int32_t)((uint64_t)p.shownWorstStages[worstStage] * 100 / (p.shownWorst ? p.shownWorst : 1)));
+    NT_drawText(130, 58, text, 12, kNT_textRight, kNT_textTiny);
+    NT_drawText(131, 58, "%", 10, kNT_textLeft, kNT_textTiny);
+
+#ifndef DISTING_HARDWARE
+    // Share of real time spent in step()
+    float seconds = (float)p.shownFrames / NT_globals.sampleRate;
+    NT_drawText(170, 58, "Load", 10, kNT_textLeft, kNT_textTiny);
+    NT_intToString(text, (int32_t)(sum * 1e-7f / seconds));
+    NT_drawText(225, 58, text, 15, kNT_textRight, kNT_textTiny);
+    NT_drawText(226, 58, "%", 10, kNT_textLeft, kNT_textTiny);
+#endif
 }
+#endif
 
 bool draw(_NT_algorithm* self) {
     _driftEngineAlgorithm* pThis = (_driftEngineAlgorithm*)self;
-    _driftEngine_DTC* dtc = pThis->dtc;
-    _driftEngine_DRAM* dram = pThis->dram;
+    _driftEngine_DTC* dtc = pThis->engine.dtc;
+    _driftEngine_DRAM* dram = pThis->engine.dram;
+
+    // Background analysis runs here, off the audio path
+    engineRunJobs(&pThis->engine, kDrawJobBudget);
+#ifdef DRIFTERS_RECORD
+    sessionWrite(pThis->session);
+#endif
+
+#ifdef DRIFTERS_PROFILE
+    drawProfile(dtc->profile);
+    return true;
+#endif
 
     // Title
     NT_drawText(10, 10, "DRIFTERS", 15, kNT_textLeft, kNT_textNormal);
@@ -1586,11 +1095,30 @@ bool draw(_NT_algorithm* self) {
         NT_drawText(10, 20, wavInfo.name, 10, kNT_textLeft, kNT_textTiny);
     }
 
+    // What the display shows: the live buffer or the active cache slot
+    bool liveDisplayMode = pThis->v[kParamLiveMode] != 0;
+    const SampleSlot* activeSlot = (dram->activeSlot >= 0) ? &dram->slots[dram->activeSlot] : NULL;
+    bool haveAudio;
+    int32_t displayLength;
+    float displayRate;
+    const float* overview;
+    if (liveDisplayMode) {
+        haveAudio = dram->liveCaptured;
+        displayLength = dram->liveLength;
+        displayRate = NT_globals.sampleRate;
+        overview = dram->liveOverview;
+    } else {
+        haveAudio = activeSlot && activeSlot->length > 0;
+        displayLength = haveAudio ? activeSlot->length : 0;
+        displayRate = haveAudio ? activeSlot->sampleRate : 48000.0f;
+        overview = haveAudio ? activeSlot->waveformOverview : NULL;
+    }
+
     // Sample length indicator
     char slotText[32];
-    if (dram->sampleLoaded) {
+    if (haveAudio) {
         // Show sample duration adjusted for sample rate
-        float secs = (float)dram->sampleLength / pThis->sourceSampleRate;
+        float secs = (float)displayLength / displayRate;
         int secInt = (int)secs;
         int secFrac = (int)((secs - secInt) * 10);
         int len = NT_intToString(slotText, secInt);
@@ -1598,7 +1126,7 @@ bool draw(_NT_algorithm* self) {
         len += NT_intToString(slotText + len, secFrac);
         slotText[len++] = 's';
         slotText[len] = 0;
-    } else if (pThis->awaitingCallback) {
+    } else if (pThis->loadActive) {
         slotText[0] = '.'; slotText[1] = '.'; slotText[2] = '.'; slotText[3] = 0;
     } else {
         slotText[0] = '-';
@@ -1614,8 +1142,6 @@ bool draw(_NT_algorithm* self) {
 
     // In Live Mode: tape delay style display
     // Write head at right edge (now), drifters read from the past (left)
-    bool liveDisplayMode = pThis->v[kParamLiveMode] != 0;
-
     if (liveDisplayMode) {
         // Draw write head at right edge
         int writeHeadX = 244;
@@ -1672,20 +1198,15 @@ bool draw(_NT_algorithm* self) {
         }
     }
 
-    // Update waveform overview in Live Mode (at display refresh rate)
-    if (pThis->v[kParamLiveMode] != 0 && dram->sampleLoaded) {
-        computeWaveformOverview(dram);
-    }
-
     // Draw waveform overview on top of everything
-    if (dram->sampleLoaded) {
+    if (haveAudio) {
         int halfH = barH / 2 - 1;  // Leave 1px margin
 
         // In Live Mode, offset drawing so write head is at right edge
         // This makes the waveform appear to scroll left as new audio is recorded
         int writeHeadPixel = 0;
-        if (liveDisplayMode && dram->sampleLength > 0) {
-            writeHeadPixel = (dtc->writePointer * kWaveformOverviewWidth) / dram->sampleLength;
+        if (liveDisplayMode && displayLength > 0) {
+            writeHeadPixel = (dtc->writePointer * kWaveformOverviewWidth) / displayLength;
         }
 
         for (int px = 0; px < kWaveformOverviewWidth; px++) {
@@ -1698,7 +1219,7 @@ bool draw(_NT_algorithm* self) {
                 srcPx = px;
             }
 
-            float amp = dram->waveformOverview[srcPx];
+            float amp = overview[srcPx];
             if (amp > 1.0f) amp = 1.0f;  // Clamp
             int h = (int)(amp * halfH);
             if (h > 0) {
@@ -1754,6 +1275,32 @@ bool draw(_NT_algorithm* self) {
     int entropyWidth = (int)(dtc->entropySmooth * 30);
     NT_drawShapeI(kNT_rectangle, 160, 49, 160 + entropyWidth, 53, 12);
 
+    // Telemetry for the last second: triggers, drops, skipped share,
+    // average and peak grains, then grains per second from each drifter
+    const GrainTelemetry& t = dtc->shownTelemetry;
+    if (t.frames > 0) {
+        float seconds = t.frames / (float)NT_globals.sampleRate;
+        NT_drawText(10, 58, "Trig", 10, kNT_textLeft, kNT_textTiny);
+        NT_intToString(statusLine, (int)(t.triggers / seconds + 0.5f));
+        NT_drawText(30, 58, statusLine, 12, kNT_textLeft, kNT_textTiny);
+        NT_drawText(50, 58, "Drop", 10, kNT_textLeft, kNT_textTiny);
+        NT_intToString(statusLine, (int)t.dropped);
+        NT_drawText(70, 58, statusLine, t.dropped ? 15 : 12, kNT_textLeft, kNT_textTiny);
+        NT_drawText(90, 58, "Skip", 10, kNT_textLeft, kNT_textTiny);
+        NT_intToString(statusLine, (int)(telemetryVolts(t, kTelemetrySkips, NT_globals.sampleRate) * 10.0f + 0.5f));
+        NT_drawText(110, 58, statusLine, t.skippedFrames ? 15 : 12, kNT_textLeft, kNT_textTiny);
+        NT_drawText(125, 58, "Avg", 10, kNT_textLeft, kNT_textTiny);
+        NT_floatToString(statusLine, telemetryVolts(t, kTelemetryGrains, NT_globals.sampleRate) * 2.0f, 1);
+        NT_drawText(142, 58, statusLine, 12, kNT_textLeft, kNT_textTiny);
+        NT_drawText(162, 58, "Pk", 10, kNT_textLeft, kNT_textTiny);
+        NT_intToString(statusLine, (int)t.peakActive);
+        NT_drawText(174, 58, statusLine, 12, kNT_textLeft, kNT_textTiny);
+        for (int d = 0; d < kNumDrifters; d++) {
+            NT_intToString(statusLine, (int)(t.drifterGrains[d] / seconds + 0.5f));
+            NT_drawText(205 + d * 13, 58, statusLine, 10, kNT_textLeft, kNT_textTiny);
+        }
+    }
+
     return true;  // Hide standard parameter line, we draw everything
 }
 
@@ -1892,8 +1439,8 @@ static const _NT_factory factory = {
     .guid = NT_MULTICHAR('T', 'h', 'D', 'r'),  // Thorinside + Drift
     .name = "Drifters",
     .description = "Granular sample explorer - 4 autonomous drifters",
-    .numSpecifications = 0,
-    .specifications = NULL,
+    .numSpecifications = kNumSpecifications,
+    .specifications = specifications,
     .calculateStaticRequirements = NULL,
     .initialise = NULL,
     .calculateRequirements = calculateRequirements,
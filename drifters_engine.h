@@ -0,0 +1,2815 @@
+/*
+ * Drifters - engine core
+ *
+ * The drifters and their grains, free of the distingNT API: no NT_* calls,
+ * no parameter indices, no globals. A host hands it memory and a
+ * configuration once, then parameter values and buffers every block:
+ *
+ *   EngineConfig config = { ... };
+ *   DriftEngine engine;
+ *   engineInit(&engine, dtcMemory, dramMemory, config);    // sizeof(_driftEngine_DTC), engineDramBytes(config)
+ *   ...put a sample in a cache slot, then engineSlotLoaded()...
+ *   engineRender(&engine, params, buffers);                 // every block
+ *   engineRunJobs(&engine, kDrawJobBudget);                 // when there is time (draw() on the module)
+ *
+ * drifters.cpp is the distingNT side: parameters, sample loading from the
+ * card, the display and the pots. Header-only, so the plugin stays a single
+ * translation unit; instances share nothing, so any number can run at once.
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#if defined(DRIFTERS_PROFILE) && !defined(DISTING_HARDWARE)
+#include <time.h>
+#endif
+
+// M_PI may not be defined in all environments
+#ifndef M_PI
+#define M_PI 3.14159265358979323846f
+#endif
+
+// ============================================================================
+// CONSTANTS
+// ============================================================================
+
+static constexpr int kNumDrifters = 4;
+static constexpr int kMaxGrainsPerDrifter = 4;
+static constexpr int kMaxTotalGrains = kNumDrifters * kMaxGrainsPerDrifter;
+static constexpr int kWaveformOverviewWidth = 236;   // Pixels for waveform display
+static constexpr int kLoadChunkFrames = 65536;       // Frames per SD read (abandon point for stale loads)
+static constexpr int kMaxCacheSlots = 8;             // Upper bound for the "Cache slots" specification
+static constexpr int kResampleTaps = 16;             // Polyphase resampler kernel length
+static constexpr int kResamplePhases = 64;           // Kernel phases (interpolated between)
+static constexpr int kInterpTaps = 8;                // HQ grain interpolation kernel length
+static constexpr int kInterpPhases = 64;             // HQ kernel phases (interpolated between)
+static constexpr int kHalfBandTaps = 16;             // Half-rate engine upsampler kernel length
+static constexpr int kFeatureBinShift = 9;           // 512 frames per feature map bin
+static constexpr int kFeatureBinFrames = 1 << kFeatureBinShift;
+static constexpr float kSilenceThreshold = 0.001f;   // Bin peak below -60dB counts as silence
+static constexpr int kZeroCrossShift = 6;            // 64 frames per zero-crossing index block
+static constexpr int kZeroCrossBlockFrames = 1 << kZeroCrossShift;
+static constexpr uint8_t kNoZeroCross = 0xFF;        // Index entry for a block without a crossing
+static constexpr int kPitchBinShift = 11;            // 2048 frames per pitch map bin
+static constexpr int kPitchBinFrames = 1 << kPitchBinShift;
+static constexpr int kPitchMapWindow = 1024;        // Pitch map detector window (hears down to ~95Hz at 48kHz)
+static constexpr float kPitchConfidence = 0.3f;      // Correlation needed to call a pitch
+static constexpr float kPitchCoarseRate = 12000.0f;  // Pitch searches scan lags at about this rate first
+static constexpr int kPitchCoarsePoints = 256;       // Largest decimated window a search holds
+static constexpr float kFixedFractionScale = 1.0f / 4294967296.0f;  // 0.32 fixed point to float
+static constexpr int kJobQueueSize = 8;              // Background job ring (power of two)
+static constexpr int kDrawJobBudget = 65536;         // Work units (frames read, correlation terms) per draw()
+static constexpr int kStepJobBudget = 1024;          // Fallback work per step() when draw() is idle
+
+
+// Filter bank center frequencies (Hz) - lowest at 250Hz to avoid granular artifacts
+static constexpr float kBandCenterFreqs[kNumDrifters] = { 250.0f, 750.0f, 1550.0f, 4000.0f };
+// Note: Stereo panning is now dynamic based on drifter position relative to anchor
+// Clock phase offsets for each drifter (used for quantized clock mode)
+// static constexpr float kClockPhaseOffset[kNumDrifters] = { 0.0f, 0.25f, 0.5f, 0.75f };
+
+// ============================================================================
+// GRAIN ENVELOPE SHAPES
+// ============================================================================
+
+enum GrainShape {
+    kShapeMist = 0,    // Soft gaussian
+    kShapeCloud,       // Tukey window
+    kShapeRain,        // Triangle
+    kShapeHail,        // Sharp attack, soft decay
+    kShapeIce,         // Square-ish
+    kNumShapes
+};
+
+// ============================================================================
+// QUALITY TIERS
+// ============================================================================
+
+enum Quality {
+    kQualityEco = 0,
+    kQualityNormal,
+    kQualityHQ,
+    kNumQualities
+};
+
+enum InterpolationMode {
+    kInterpLinear,     // 2 points
+    kInterpCubic,      // 4-point Hermite
+    kInterpSinc,       // 8-tap windowed-sinc polyphase
+};
+
+// Everything a tier selects - one Quality parameter trades CPU for fidelity
+// without having to tune each of these separately
+struct QualityTier {
+    uint8_t interpolation;     // InterpolationMode for grain reads
+    bool perGrainFilter;       // Spectrum filter per grain (else once per drifter bus)
+    bool exactClipper;         // tanhf output clipper (else a rational approximation)
+    uint8_t envelopeBits;      // Envelope table holds 2^bits points
+    bool envelopeLerp;         // Interpolate between envelope table points
+    uint8_t controlDivisor;    // Frames per drifter/trigger update
+    uint8_t maxActiveGrains;   // Grains rendered at once (the rest wait silently)
+    bool halfRate;             // Render at half the NT rate and upsample
+};
+
+static const QualityTier kQualityTiers[kNumQualities] = {
+    { kInterpLinear, false, false,  8, false, 16,  6, true  },   // Eco
+    { kInterpCubic,  false, false, 10, true,   4,  8, false },   // Normal
+    { kInterpSinc,   true,  true,  12, true,   1, 16, false },   // HQ
+};
+
+// Envelope tables for every tier and shape, each with a guard point at phase 1
+static constexpr int kEnvelopeTableFloats =
+    kNumShapes * (((1 << 8) + 1) + ((1 << 10) + 1) + ((1 << 12) + 1));
+
+struct Scale {
+    const int8_t* notes;
+    uint8_t noteCount;
+};
+
+static const int8_t scaleChromatic[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+static const int8_t scaleIonian[] = { 0, 2, 4, 5, 7, 9, 11 };
+static const int8_t scaleDorian[] = { 0, 2, 3, 5, 7, 9, 10 };
+static const int8_t scalePhrygian[] = { 0, 1, 3, 5, 7, 8, 10 };
+static const int8_t scaleLydian[] = { 0, 2, 4, 6, 7, 9, 11 };
+static const int8_t scaleMixolydian[] = { 0, 2, 4, 5, 7, 9, 10 };
+static const int8_t scaleAeolian[] = { 0, 2, 3, 5, 7, 8, 10 };
+static const int8_t scaleLocrian[] = { 0, 1, 3, 5, 6, 8, 10 };
+static const int8_t scaleMajorFlat6[] = { 0, 2, 4, 5, 7, 8, 11 };
+static const int8_t scaleMinorFlat6[] = { 0, 2, 3, 5, 7, 8, 10 };
+static const int8_t scaleLydianSharp4[] = { 0, 2, 4, 6, 7, 9, 10 };
+static const int8_t scaleHungarian[] = { 0, 2, 3, 6, 7, 8, 11 };
+static const int8_t scalePersian[] = { 0, 1, 4, 5, 6, 8, 11 };
+static const int8_t scaleByzantine[] = { 0, 1, 4, 5, 7, 8, 11 };
+static const int8_t scaleEnigmatic[] = { 0, 1, 4, 6, 8, 10, 11 };
+static const int8_t scaleNeapolitan[] = { 0, 1, 3, 5, 7, 8, 11 };
+static const int8_t scaleHirajoshi[] = { 0, 2, 3, 7, 8 };
+static const int8_t scaleIwato[] = { 0, 1, 5, 6, 10 };
+static const int8_t scalePelog[] = { 0, 1, 3, 7, 10 };
+static const int8_t scaleRyo[] = { 0, 2, 4, 7, 9 };
+static const int8_t scaleRitsu[] = { 0, 2, 5, 7, 9 };
+static const int8_t scaleYo[] = { 0, 2, 5, 7, 10 };
+
+static const Scale scales[] = {
+    { scaleChromatic, 12 },
+    { scaleIonian, 7 },
+    { scaleDorian, 7 },
+    { scalePhrygian, 7 },
+    { scaleLydian, 7 },
+    { scaleMixolydian, 7 },
+    { scaleAeolian, 7 },
+    { scaleLocrian, 7 },
+    { scaleMajorFlat6, 7 },
+    { scaleMinorFlat6, 7 },
+    { scaleLydianSharp4, 7 },
+    { scaleHungarian, 7 },
+    { scalePersian, 7 },
+    { scaleByzantine, 7 },
+    { scaleEnigmatic, 7 },
+    { scaleNeapolitan, 7 },
+    { scaleHirajoshi, 5 },
+    { scaleIwato, 5 },
+    { scalePelog, 5 },
+    { scaleRyo, 5 },
+    { scaleRitsu, 5 },
+    { scaleYo, 5 }
+};
+
+// Check if a semitone is in the major scale
+static bool isInMajorScale(int8_t semitone) {
+    // Major scale semitones: 0, 2, 4, 5, 7, 9, 11
+    semitone = ((semitone % 12) + 12) % 12;  // Normalize to 0-11
+    return semitone == 0 || semitone == 2 || semitone == 4 ||
+           semitone == 5 || semitone == 7 || semitone == 9 || semitone == 11;
+}
+
+// ============================================================================
+// DATA STRUCTURES
+// ============================================================================
+
+// Simple 2-pole state variable filter for each drifter
+struct BandFilter {
+    float lowpass;
+    float bandpass;
+    float highpass;
+
+    void reset() { lowpass = bandpass = highpass = 0; }
+
+    // Flush denormals to zero
+    static inline float flushDenormal(float x) {
+        return (fabsf(x) < 1e-20f) ? 0.0f : x;
+    }
+
+    // Frequency coefficient for a centre frequency (once per block, not per sample)
+    static float coefficient(float freq, float sr) {
+        // Clamp frequency coefficient for stability
+        float f = 2.0f * sinf(M_PI * fminf(freq, sr * 0.4f) / sr);
+        return fminf(f, 0.7f);  // Conservative stability limit
+    }
+
+    float process(float input, float f, float q) {
+        // Clamp Q to prevent instability
+        q = fminf(q, 0.95f);
+
+        lowpass += f * bandpass;
+        highpass = input - lowpass - q * bandpass;
+        bandpass += f * highpass;
+
+        // Prevent denormals and NaN
+        lowpass = flushDenormal(lowpass);
+        bandpass = flushDenormal(bandpass);
+        highpass = flushDenormal(highpass);
+
+        // NaN protection
+        if (lowpass != lowpass) lowpass = 0;
+        if (bandpass != bandpass) bandpass = 0;
+        if (highpass != highpass) highpass = 0;
+
+        return bandpass;  // Use bandpass for spectral separation
+    }
+};
+
+// Single grain instance
+struct Grain {
+    bool active;
+    uint64_t position;     // Playback position in frames, 32.32 fixed point
+    uint64_t positionDelta;// Playback rate (pitch), 32.32
+    uint32_t phase;        // Envelope phase 0-1, 0.32 fixed point
+    uint32_t phaseDelta;   // Envelope rate, 0.32
+    int drifterIndex;      // Which drifter spawned this grain
+    GrainShape shape;      // Envelope shape
+    float amplitude;       // Grain amplitude
+    int32_t featureBin;    // Feature map bin last looked up (-1 = none)
+    bool silent;           // That bin is silent - skip rendering
+    uint8_t source;        // GrainSourceType the grain reads from
+    float proximityGain;   // Live Mode write-head fade (ramped across the block)
+    float proximityStep;
+    BandFilter filterL;    // Spectrum filter (tiers with perGrainFilter)
+    BandFilter filterR;
+};
+
+// Drifter state
+struct Drifter {
+    float position;        // Current position in sample (0-1)
+    float velocity;        // Current drift velocity
+    float pitchOffset;     // Pitch offset in semitones
+    float timeSinceGrain;  // Time since last grain trigger
+    float nextGrainTime;   // Time until next grain (Poisson)
+    float variation;       // Per-drifter speed variation (0.5-1.0), set once
+    float driftDirection;  // -1 or +1, set once at init
+    float boredom;         // Builds up when staying in same region (0-1)
+    float lastSignificantPos; // Position when boredom last reset
+    float livePitch;       // Pitch last measured at a trigger in the running live buffer
+};
+
+
+// ============================================================================
+// PROFILING (build with -DDRIFTERS_PROFILE)
+// ============================================================================
+// step() charges the time since the previous mark to the stage just
+// finished. Totals cover one second of audio and draw() shows the last
+// complete second in place of the usual display, with the worst block in it.
+
+#ifdef DRIFTERS_PROFILE
+
+enum ProfileStage {
+    kStageSetup,       // Block setup: jobs, sources, tier, per-block tables
+    kStageCapture,     // Live Mode capture
+    kStagePhysics,     // Smoothing and drifter motion
+    kStageTrigger,     // Trigger decisions and grain allocation
+    kStageGrains,      // Grain reads and envelopes
+    kStageBuses,       // Per-drifter filter, tilt, pan and normalisation
+    kStageOutput,      // Upsampling, wet/dry mix, clipping, CV outputs
+
+    kNumStages
+};
+
+static const char* const stageNames[] = { "Setup", "Capture", "Physics", "Trigger", "Grains", "Buses", "Output" };
+
+#ifdef DISTING_HARDWARE
+// Cortex-M7 DWT cycle counter
+static volatile uint32_t* const kDwtControl = (volatile uint32_t*)0xE0001000;
+static volatile uint32_t* const kDwtCycleCount = (volatile uint32_t*)0xE0001004;
+static volatile uint32_t* const kDebugExceptionControl = (volatile uint32_t*)0xE000EDFC;
+static const char* const kProfileUnit = "cyc";
+
+static void profileStartTimer() {
+    *kDebugExceptionControl |= 1u << 24;  // TRCENA
+    *kDwtControl |= 1u;                   // CYCCNTENA
+}
+
+static inline uint32_t profileNow() {
+    return *kDwtCycleCount;
+}
+#else
+static const char* const kProfileUnit = "ns";
+
+static void profileStartTimer() {
+}
+
+static inline uint32_t profileNow() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)ts.tv_sec * 1000000000u + (uint32_t)ts.tv_nsec;  // Wraps; only differences matter
+}
+#endif
+
+struct StageProfile {
+    uint32_t mark;                         // Time of the last mark
+    uint32_t block[kNumStages];            // This block so far
+
+    // The second being measured
+    uint64_t total[kNumStages];
+    uint32_t blocks;
+    uint32_t frames;
+    uint32_t worst;
+    uint32_t worstStages[kNumStages];
+
+    // The last complete second, for draw()
+    uint64_t shownTotal[kNumStages];
+    uint32_t shownBlocks;
+    uint32_t shownFrames;
+    uint32_t shownWorst;
+    uint32_t shownWorstStages[kNumStages];
+};
+
+static inline void profileBeginBlock(StageProfile& p) {
+    memset(p.block, 0, sizeof(p.block));
+    p.mark = profileNow();
+}
+
+static inline void profileMark(StageProfile& p, int stage) {
+    uint32_t now = profileNow();
+    p.block[stage] += now - p.mark;
+    p.mark = now;
+}
+
+static void profileEndBlock(StageProfile& p, int numFrames, uint32_t sampleRate) {
+    uint32_t blockTotal = 0;
+    for (int s = 0; s < kNumStages; s++) {
+        p.total[s] += p.block[s];
+        blockTotal += p.block[s];
+    }
+    if (blockTotal > p.worst) {
+        p.worst = blockTotal;
+        memcpy(p.worstStages, p.block, sizeof(p.block));
+    }
+    p.blocks++;
+    p.frames += numFrames;
+
+    if (p.frames >= sampleRate) {
+        memcpy(p.shownTotal, p.total, sizeof(p.total));
+        memcpy(p.shownWorstStages, p.worstStages, sizeof(p.worstStages));
+        p.shownBlocks = p.blocks;
+        p.shownFrames = p.frames;
+        p.shownWorst = p.worst;
+        memset(p.total, 0, sizeof(p.total));
+        p.blocks = 0;
+        p.frames = 0;
+        p.worst = 0;
+    }
+}
+
+#define PROFILE_MARK(stage) profileMark(dtc->profile, stage)
+#else
+#define PROFILE_MARK(stage)
+#endif
+
+// ============================================================================
+// TELEMETRY
+// ============================================================================
+// Counted over one second of audio, then held for the display and the
+// Telemetry CV output - enough to tell whether Density is being heard or
+// grains are being lost
+
+enum TelemetryMode {
+    kTelemetryTriggers,    // Triggers per second, 0.05V each (10V = 200/s)
+    kTelemetryDrops,       // Share of triggers that found no free grain, 10V = all
+    kTelemetrySkips,       // Share of sounding grain-frames left unrendered, 10V = all
+    kTelemetryGrains,      // Average grains active, 0.5V each
+
+    kNumTelemetryModes
+};
+
+struct GrainTelemetry {
+    uint32_t frames;           // NT frames counted (the window closes at one second)
+    uint32_t engineFrames;     // Engine frames counted (half as many at half rate)
+    uint32_t triggers;         // Grain triggers
+    uint32_t dropped;          // Triggers that found every grain slot busy
+    uint32_t silent;           // Grains released at birth (they would only read silence)
+    uint32_t activeFrames;     // Active grains summed over engine frames
+    uint32_t skippedFrames;    // Grain-frames over the tier's limit, not rendered
+    uint32_t peakActive;
+    uint32_t drifterGrains[kNumDrifters];  // Grains started by each drifter
+};
+
+static float telemetryVolts(const GrainTelemetry& t, int mode, float sampleRate) {
+    float seconds = t.frames / sampleRate;
+    switch (mode) {
+        case kTelemetryTriggers:
+            return seconds > 0 ? fminf(10.0f, 0.05f * t.triggers / seconds) : 0;
+        case kTelemetryDrops:
+            return t.triggers ? 10.0f * t.dropped / t.triggers : 0;
+        case kTelemetrySkips:
+            return t.activeFrames ? 10.0f * t.skippedFrames / t.activeFrames : 0;
+        case kTelemetryGrains:
+            return t.engineFrames ? 0.5f * t.activeFrames / t.engineFrames : 0;
+    }
+    return 0;
+}
+
+// Close the second once it is full, then hold the chosen reading on the
+// Telemetry CV output (if assigned) for the whole block
+static void telemetryEndBlock(GrainTelemetry& t, GrainTelemetry& shown, int numFrames,
+                              float* cvOut, int mode, float sampleRate) {
+    t.frames += numFrames;
+    if (t.frames >= sampleRate) {
+        shown = t;
+        memset(&t, 0, sizeof(t));
+    }
+    if (cvOut) {
+        float volts = telemetryVolts(shown, mode, sampleRate);
+        for (int i = 0; i < numFrames; i++) cvOut[i] = volts;
+    }
+}
+
+// DTC - Performance critical data
+struct _driftEngine_DTC {
+    Drifter drifters[kNumDrifters];
+    Grain grains[kMaxTotalGrains];
+
+    // Smoothed parameter values
+    float anchorSmooth;
+    float driftSmooth;
+    float densitySmooth;
+    float entropySmooth;
+    float stormLevel;      // Current storm intensity (decays)
+
+    // Clock sync state
+    float clockPhase;
+    float clockPeriod;
+    bool clockReceived;
+    float prevClock;
+
+    // Output for CV
+    float averagePosition;
+    bool pulseOut;
+
+    // Smoothed normalization factor (anti-click)
+    float smoothNorm;
+
+    // Random state
+    uint32_t randState;
+
+    // Live Mode state
+    int writePointer;      // Circular buffer write position
+    int captureOverviewPixel;   // Overview column the write head is filling
+    float captureOverviewPeak;  // Peak captured so far in that column
+    bool frozen;           // Freeze state (write pointer stopped)
+    bool prevLiveMode;     // Previous Live Mode state for crossfade detection
+
+    // Crossfade state for mode switching
+    bool crossfadeActive;       // True during mode transition
+    float crossfadeSamples;     // Total crossfade duration in samples (50ms)
+    float crossfadeCounter;     // Current position in crossfade
+    float sampleModeGain;       // Gain for sample mode audio
+    float liveModeGain;         // Gain for live mode audio
+
+    // Control rate (drifters update every controlDivisor frames)
+    int controlCountdown;       // Frames until the next control update
+    bool clockPending;          // Clock edge seen since the last control update
+
+    // Per-drifter bus processing (grains are summed per drifter first)
+    BandFilter drifterFilterL[kNumDrifters];
+    BandFilter drifterFilterR[kNumDrifters];
+    float drifterPanL[kNumDrifters];    // Pan gains, updated with drifter positions
+    float drifterPanR[kNumDrifters];
+
+    // Half-rate engine: half-band upsampler taps and the last engine frames
+    float halfBand[kHalfBandTaps];
+    float upsampleHistoryL[kHalfBandTaps];
+    float upsampleHistoryR[kHalfBandTaps];
+    bool halfRateActive;        // Previous block ran at half rate
+
+    // Telemetry: the second being counted and the last complete one
+    GrainTelemetry telemetry;
+    GrainTelemetry shownTelemetry;
+
+#ifdef DRIFTERS_PROFILE
+    StageProfile profile;
+#endif
+};
+
+// Detected pitch for one pitch map bin
+struct PitchBin {
+    int16_t pitch;             // Semitones from A4 * 256 (0 when no clear pitch)
+    uint16_t confidence;       // Winning autocorrelation, 16-bit fixed point
+};
+
+// Coarse content analysis for one bin of a cached sample
+// Levels are 16-bit fixed point (65535 = full scale)
+struct FeatureBin {
+    uint16_t rms;
+    uint16_t peak;
+    uint16_t onset;            // Positive RMS flux from the previous bin
+    uint16_t silentRun;        // Consecutive silent bins starting here (0 = not silent)
+};
+
+// Acceleration structures built over a static stretch of audio by background
+// jobs. Each map is only valid once its count is published (non-zero).
+// Counts are only written by step(): a job finishing in draw() just records
+// that it is done, and step() publishes it if the audio is still the same
+struct AnalysisMaps {
+    FeatureBin* features;      // Feature map (numFeatureBins valid once analysed)
+    int32_t numFeatureBins;
+    uint8_t* zeroCrossings;    // Best crossing offset per 64-frame block (valid once indexed)
+    int32_t numZeroCrossBlocks;
+    PitchBin* pitchMap;        // Detected pitch per 2048-frame bin (numPitchBins valid once mapped)
+    int32_t numPitchBins;
+    uint32_t generation;       // Bumped when the audio changes - background jobs check it
+    uint8_t jobsPosted;        // JobType bits posted for this generation (step() only)
+    volatile uint32_t finishedGeneration;  // Generation finishedJobs belong to (draw() only)
+    volatile uint8_t finishedJobs;         // JobType bits finished for it (draw() only)
+};
+
+// One decoded sample held in the DRAM cache
+// Frame storage is carved from DRAM after _driftEngine_DRAM (float or int16 mono)
+struct SampleSlot {
+    float* frames;             // Float storage (NULL when int16-packed)
+    int16_t* packed;           // Int16 storage (NULL when float)
+    AnalysisMaps maps;
+    int32_t capacity;          // Frames available in this slot
+    int32_t folder;            // Cache key (-1 = empty)
+    int32_t sample;
+    int32_t length;            // Loaded length in frames (0 = not playable)
+    float sampleRate;          // Sample rate of the stored frames
+    uint32_t lastUsed;         // LRU stamp
+
+    // Waveform overview for display (kept per slot so switching is instant)
+    float waveformOverview[kWaveformOverviewWidth];
+};
+
+// Read-only view of the frames grains play from (cache slot or live buffer)
+struct SampleView {
+    const float* left;         // Float frames (NULL when int16-packed)
+    const float* right;        // Right channel (stereo live capture only)
+    const int16_t* packed;     // Int16-packed mono frames
+    int32_t length;
+
+    inline float read(int pos) const {
+        return left ? left[pos] : packed[pos] * (1.0f / 32768.0f);
+    }
+};
+
+// Where a grain reads from - both stay resident, so grains born before a
+// Live Mode switch keep sounding from their own source while they fade out
+enum GrainSourceType {
+    kSourceSample,
+    kSourceLive,
+
+    kNumGrainSources
+};
+
+// A grain source and whatever analysis of it is ready
+struct GrainSource {
+    SampleView view;
+    float sampleRate;
+    const FeatureBin* features;     // NULL until analysed (live: only while frozen)
+    int32_t numFeatureBins;
+    const uint8_t* zeroCrossings;   // NULL until indexed
+    int32_t numZeroCrossBlocks;
+    const PitchBin* pitchMap;       // NULL until mapped
+    int32_t numPitchBins;
+};
+
+// Point a grain source at whichever of its maps have been published
+static void attachMaps(GrainSource& source, const AnalysisMaps& maps) {
+    if (maps.numFeatureBins > 0) {
+        source.features = maps.features;
+        source.numFeatureBins = maps.numFeatureBins;
+    }
+    if (maps.numZeroCrossBlocks > 0) {
+        source.zeroCrossings = maps.zeroCrossings;
+        source.numZeroCrossBlocks = maps.numZeroCrossBlocks;
+    }
+    if (maps.numPitchBins > 0) {
+        source.pitchMap = maps.pitchMap;
+        source.numPitchBins = maps.numPitchBins;
+    }
+}
+
+// DRAM - Large sample buffers
+struct _driftEngine_DRAM {
+    // Live Mode capture buffer (storage follows this struct)
+    float* liveBufferL;
+    float* liveBufferR;
+    int32_t liveCapacity;      // Frames reserved per channel ("Live seconds")
+    int32_t liveLength;        // Live buffer length in frames
+    bool liveCaptured;         // Capture has started (buffer holds audio)
+    bool liveIsStereo;
+
+    // Live waveform overview for display (peak amplitude per pixel column)
+    float liveOverview[kWaveformOverviewWidth];
+
+    // Analysis of the live buffer, built while it is frozen
+    AnalysisMaps liveMaps;
+
+    // Sample cache - slot table (frame storage follows this struct)
+    SampleSlot slots[kMaxCacheSlots];
+    int32_t numSlots;
+    int32_t activeSlot;        // Slot sample mode plays from (-1 = none)
+    uint32_t useCounter;       // LRU clock
+
+    // Load-time resampling (storageRate 0 = keep files at their native rate)
+    float storageRate;
+    float* resampleStaging;    // History + one load chunk of native-rate frames
+    float resampleKernel[kResamplePhases + 1][kResampleTaps];
+
+    // Grain rendering tables (built at construct)
+    float interpKernel[kInterpPhases + 1][kInterpTaps];
+    float envelopeTables[kEnvelopeTableFloats];
+    const float* envelopes[kNumQualities][kNumShapes];
+};
+
+// ============================================================================
+// MEMORY LAYOUT
+// ============================================================================
+
+// Feature map bins needed to cover a number of frames
+static int32_t featureBinsForFrames(int32_t frames) {
+    return (frames + kFeatureBinFrames - 1) >> kFeatureBinShift;
+}
+
+// Zero-crossing index blocks needed to cover a number of frames
+static int32_t zeroCrossBlocksForFrames(int32_t frames) {
+    return (frames + kZeroCrossBlockFrames - 1) >> kZeroCrossShift;
+}
+
+// Pitch map bins needed to cover a number of frames
+static int32_t pitchBinsForFrames(int32_t frames) {
+    return (frames + kPitchBinFrames - 1) >> kPitchBinShift;
+}
+
+// DRAM for the analysis maps of `frames` frames (a cache slot or the live buffer):
+// feature map, pitch map, then zero-crossing index (rounded to keep whatever
+// follows 4-byte aligned)
+static int32_t analysisBytes(int32_t frames) {
+    return featureBinsForFrames(frames) * sizeof(FeatureBin) +
+           pitchBinsForFrames(frames) * sizeof(PitchBin) +
+           ((zeroCrossBlocksForFrames(frames) + 3) & ~3);
+}
+
+// Carve analysis maps for `frames` frames from `memory`, returning the end
+static uint8_t* carveAnalysisMaps(AnalysisMaps& maps, uint8_t* memory, int32_t frames) {
+    maps.features = (FeatureBin*)memory;
+    maps.pitchMap = (PitchBin*)(memory + featureBinsForFrames(frames) * sizeof(FeatureBin));
+    maps.zeroCrossings = (uint8_t*)(maps.pitchMap + pitchBinsForFrames(frames));
+    return memory + analysisBytes(frames);
+}
+
+// ============================================================================
+// BACKGROUND JOBS
+// ============================================================================
+
+// Non-real-time work (analysis maps, index building, overviews) is posted by
+// step() and run in budgeted slices from draw(), keeping the audio thread's
+// cost flat however much analysis gets added. step() only runs a small slice
+// itself when draw() has gone quiet (display showing another algorithm).
+
+enum JobType {
+    kJobFeatureMap,        // Feature map (+ overview for cache slots)
+    kJobZeroCrossIndex,    // Zero-crossing index
+    kJobPitchMap,          // Pitch map (only wanted while a scale is selected)
+
+    kNumJobTypes
+};
+
+static constexpr int kJobLive = -1;  // Job target: the frozen live buffer rather than a cache slot
+
+struct Job {
+    uint8_t type;
+    int8_t slot;           // Cache slot, or kJobLive
+    uint32_t generation;   // Maps generation the job was posted for
+};
+
+// An autocorrelation pitch search, resumable between lags so a slice of
+// background work never has to finish a whole window. Lags are scanned
+// coarsely on a decimated copy of the window, then refined at full rate
+// around the best one
+struct PitchSearch {
+    int factor;            // Frames per decimated point
+    int points;            // Decimated points in the window (0 until decimated)
+    int minLag;            // Full-rate lag range
+    int maxLag;
+    int lag;               // Next lag to try (decimated points, then frames once refining)
+    int endLag;            // The stage is over when lag reaches it
+    bool refining;
+    bool done;
+    int bestLag;           // Best lag of the current stage
+    float bestCorr;
+    float coarse[kPitchCoarsePoints];
+};
+
+// Lock-free single-producer (step) / single-consumer (draw) ring
+struct JobQueue {
+    Job jobs[kJobQueueSize];
+    volatile uint32_t head;    // Only written by the producer
+    volatile uint32_t tail;    // Only written by the consumer
+};
+
+// ============================================================================
+// ENGINE INTERFACE
+// ============================================================================
+// Everything the engine is given: a configuration fixed at init, parameter
+// values and buffers for each block. Parameters keep the units of the
+// plugin's parameters, so a host can pass values straight through.
+
+// Memory layout, fixed for the life of an instance
+struct EngineConfig {
+    int32_t cacheSlots;        // Sample cache slots (1 to kMaxCacheSlots)
+    int32_t slotFrames;        // Capacity of each slot in stored frames
+    bool packed;               // Slots hold int16 rather than float frames
+    float storageRate;         // Rate samples are resampled to at load (0 = keep native)
+    int32_t liveFrames;        // Live Mode buffer capacity per channel
+    int32_t seed;              // Random seed (0 = the original fixed seed)
+};
+
+// Performance parameters for one block
+struct EngineParams {
+    bool liveMode;             // Grains read the live buffer instead of the cache
+    int16_t mix;               // Live Mode wet/dry, percent wet
+    bool freeze;               // Live buffer stops capturing
+    int16_t minDelay;          // Live grains' distance behind the write head, tenths of ms
+    int16_t anchor;            // Percent
+    int16_t wander;            // Percent
+    int16_t gravity;           // -100 to 100 percent
+    int16_t drift;             // Percent
+    int16_t seek;              // -100 to 100 percent
+    int16_t density;           // Percent
+    int16_t deviation;         // Percent
+    int16_t pitch;             // Semitones
+    int16_t scatter;           // Semitones (or scale degrees with a scale)
+    int16_t scale;             // Index into scales[] (0 = chromatic)
+    int16_t spectrum;          // Percent
+    int16_t tilt;              // -100 to 100 percent
+    int16_t shape;             // GrainShape
+    int16_t entropy;           // Percent
+    int16_t quality;           // Quality
+    int16_t telemetry;         // TelemetryMode for cvOutTelemetry
+};
+
+// Audio and CV for one block, numFrames frames each
+// Unpatched inputs and unwanted outputs are NULL
+struct EngineBuffers {
+    int numFrames;             // A multiple of 4
+    float sampleRate;          // Host sample rate
+
+    // CV inputs
+    const float* cvAnchor;     // +-5V = +-50%
+    const float* cvPitch;      // 1V/octave
+    const float* cvDrift;      // +-5V = +-100%
+    const float* cvEntropy;    // 0-5V = 0-100%
+    const float* cvStorm;      // Gate, high above 1V
+    const float* cvClock;      // Rising edges above 1V
+
+    // Live Mode audio inputs
+    const float* inputL;
+    const float* inputR;
+
+    // Audio outputs, replaced or mixed into
+    float* outL;
+    float* outR;
+    bool replaceL;
+    bool replaceR;
+
+    // CV outputs (always replaced)
+    float* cvOutPosition;      // Average drifter position, 0-5V
+    float* cvOutPulse;         // 5V for a frame at each grain start
+    float* cvOutTelemetry;     // EngineParams::telemetry reading
+
+    // Scratch memory for the half-rate engine (Eco); without enough of it
+    // the block renders at full rate
+    float* scratch;
+    uint32_t scratchBytes;
+};
+
+// One engine instance: its DTC and DRAM, and the background analysis that
+// step() posts and draw() works through
+struct DriftEngine {
+    _driftEngine_DTC* dtc;
+    _driftEngine_DRAM* dram;
+    float sampleRate;              // Host rate of the latest block
+
+    // Background jobs
+    JobQueue jobs;
+    Job currentJob;                // Job the consumer is working through
+    bool jobRunning;
+    int32_t jobProgress;           // Units (bins/blocks/pixels) done so far
+    PitchSearch pitchSearch;       // Pitch map job: the bin at jobProgress, part searched
+    bool pitchBinOpen;             // pitchSearch holds a bin in progress
+    volatile bool jobConsumerBusy; // draw() is mid-slice - step() must not consume
+    int32_t framesSinceDrawJobs;   // Audio frames since draw() last ran jobs
+};
+
+// ============================================================================
+// HELPER FUNCTIONS
+// ============================================================================
+
+// Fast pseudo-random number generator (Xorshift32)
+static inline uint32_t xorshift32(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+// Xorshift state for a Seed specification
+// Seeds are scrambled so neighbouring values start unrelated sequences;
+// 0 keeps the seed every earlier version used.
+static uint32_t seedState(int32_t seed) {
+    if (seed == 0) return 0x12345678;
+    uint32_t x = (uint32_t)seed * 0x9E3779B9u;
+    x ^= x >> 16;
+    x *= 0x85EBCA6Bu;
+    x ^= x >> 13;
+    x *= 0xC2B2AE35u;
+    x ^= x >> 16;
+    return x ? x : 0x12345678;  // Xorshift never leaves zero
+}
+
+// Random float 0-1
+static inline float randFloat(_driftEngine_DTC* dtc) {
+    return (float)xorshift32(&dtc->randState) / (float)0xFFFFFFFF;
+}
+
+// Find nearest zero crossing in sample buffer
+static int findNearestZeroCrossing(const SampleView& buffer, int startPos, int searchRadius = 64) {
+    int sampleLen = buffer.length;
+
+    // Guard against division by zero
+    if (sampleLen <= 0) return 0;
+
+    int bestPos = startPos % sampleLen;
+    float bestVal = fabsf(buffer.read(bestPos));
+
+    for (int offset = 1; offset <= searchRadius; offset++) {
+        // Search forward
+        int posF = (startPos + offset) % sampleLen;
+        float valF = fabsf(buffer.read(posF));
+        if (valF < bestVal) {
+            bestVal = valF;
+            bestPos = posF;
+        }
+        // Also check for actual zero crossing (sign change)
+        if (offset > 0) {
+            int prevF = (startPos + offset - 1) % sampleLen;
+            if (buffer.read(prevF) * buffer.read(posF) < 0) {
+                // Zero crossing found
+                return (fabsf(buffer.read(prevF)) < fabsf(buffer.read(posF))) ? prevF : posF;
+            }
+        }
+
+        // Search backward
+        int posB = (startPos - offset + sampleLen) % sampleLen;
+        float valB = fabsf(buffer.read(posB));
+        if (valB < bestVal) {
+            bestVal = valB;
+            bestPos = posB;
+        }
+        if (offset > 0) {
+            int prevB = (startPos - offset + 1 + sampleLen) % sampleLen;
+            if (buffer.read(prevB) * buffer.read(posB) < 0) {
+                return (fabsf(buffer.read(prevB)) < fabsf(buffer.read(posB))) ? prevB : posB;
+            }
+        }
+    }
+
+    return bestPos;
+}
+
+// Random float -1 to +1
+static inline float randFloatBipolar(_driftEngine_DTC* dtc) {
+    return randFloat(dtc) * 2.0f - 1.0f;
+}
+
+// Exponential distribution for Poisson process
+static inline float randExponential(_driftEngine_DTC* dtc, float lambda) {
+    float u = randFloat(dtc);
+    if (u < 0.0001f) u = 0.0001f;  // Avoid log(0)
+    return -logf(u) / lambda;
+}
+
+// Get a random scale degree, biased toward characteristic notes (those not in major)
+// Returns a degree offset (can be negative or positive)
+static int getCharacteristicDegree(_driftEngine_DTC* dtc, int scaleIndex, int maxDegrees) {
+    if (scaleIndex <= 1) {  // Chromatic or Ionian - no bias needed
+        return (int)(randFloat(dtc) * (maxDegrees * 2 + 1)) - maxDegrees;
+    }
+
+    const Scale& scale = scales[scaleIndex];
+
+    // Try up to 4 times to find a characteristic note
+    for (int attempt = 0; attempt < 4; attempt++) {
+        int degree = (int)(randFloat(dtc) * (maxDegrees * 2 + 1)) - maxDegrees;
+
+        // Get the semitone for this degree
+        int octave = degree / (int)scale.noteCount;
+        int degreeInOctave = degree % (int)scale.noteCount;
+        if (degreeInOctave < 0) {
+            degreeInOctave += scale.noteCount;
+            octave -= 1;
+        }
+        int8_t semitone = scale.notes[degreeInOctave];
+
+        // If this note is NOT in major scale, prefer it (70% chance to keep)
+        if (!isInMajorScale(semitone)) {
+            if (randFloat(dtc) < 0.7f) {
+                return degree;
+            }
+        }
+        // If in major scale, only 30% chance to keep, otherwise try again
+        if (randFloat(dtc) < 0.3f) {
+            return degree;
+        }
+    }
+
+    // Fallback: return last attempted degree
+    return (int)(randFloat(dtc) * (maxDegrees * 2 + 1)) - maxDegrees;
+}
+
+// Compute grain envelope value
+static float grainEnvelope(float phase, GrainShape shape) {
+    if (phase < 0 || phase > 1) return 0;
+
+    // Universal safety fade at boundaries (3% fade-in/out for click reduction)
+    float fade = 1.0f;
+    const float fadeLen = 0.03f;
+    if (phase < fadeLen) fade = phase / fadeLen;
+    else if (phase > 1.0f - fadeLen) fade = (1.0f - phase) / fadeLen;
+
+    float env = 1.0f;
+    switch (shape) {
+        case kShapeMist: {
+            // Gaussian-ish: sin^2 approximation
+            float x = phase * M_PI;
+            float s = sinf(x);
+            env = s * s;
+            break;
+        }
+        case kShapeCloud: {
+            // Tukey window (tapered cosine)
+            float alpha = 0.5f;
+            if (phase < alpha/2) {
+                env = 0.5f * (1 - cosf(2*M_PI*phase/alpha));
+            } else if (phase > 1 - alpha/2) {
+                env = 0.5f * (1 - cosf(2*M_PI*(1-phase)/alpha));
+            } else {
+                env = 1.0f;
+            }
+            break;
+        }
+        case kShapeRain:
+            // Triangle
+            env = phase < 0.5f ? phase * 2 : (1 - phase) * 2;
+            break;
+
+        case kShapeHail: {
+            // Sharp attack, exponential decay
+            if (phase < 0.1f) env = phase * 10;
+            else env = expf(-4.0f * (phase - 0.1f));
+            break;
+        }
+
+        case kShapeIce:
+            // Near-square with tiny fade
+            if (phase < 0.02f) env = phase * 50;
+            else if (phase > 0.98f) env = (1 - phase) * 50;
+            else env = 1.0f;
+            break;
+
+        default:
+            env = 1.0f;
+            break;
+    }
+
+    return env * fade;
+}
+
+// Tabulate every shape at each tier's resolution (construct time only)
+static void buildEnvelopeTables(_driftEngine_DRAM* dram) {
+    float* table = dram->envelopeTables;
+    for (int q = 0; q < kNumQualities; q++) {
+        int size = 1 << kQualityTiers[q].envelopeBits;
+        for (int shape = 0; shape < kNumShapes; shape++) {
+            for (int i = 0; i <= size; i++) {
+                table[i] = grainEnvelope((float)i / size, (GrainShape)shape);
+            }
+            dram->envelopes[q][shape] = table;
+            table += size + 1;
+        }
+    }
+}
+
+// Envelope value at a 0.32 fixed-point phase from a table of 2^bits points
+static inline float lookupEnvelope(const float* table, int bits, bool lerp, uint32_t phase) {
+    uint32_t index = phase >> (32 - bits);
+    if (!lerp) return table[index];
+    float frac = (float)(phase << bits) * kFixedFractionScale;
+    return table[index] + (table[index + 1] - table[index]) * frac;
+}
+
+// Rational tanh approximation (exact slope at 0, meets +-1 at +-3)
+static inline float softClip(float x) {
+    if (x > 3.0f) return 1.0f;
+    if (x < -3.0f) return -1.0f;
+    float x2 = x * x;
+    return x * (27.0f + x2) / (27.0f + 9.0f * x2);
+}
+
+// Wet/dry mix, soft clip and NaN/Inf guard for one output sample
+// dryIn is NULL when there is no dry signal to blend
+static inline float finishOutput(float wetMix, const float* dryIn, int frame, float wet, bool exactClipper) {
+    float mix = dryIn ? wetMix * wet + dryIn[frame] * (1.0f - wet) : wetMix;
+
+    // Soft clipping with Eurorack-level output (±5V)
+    mix = exactClipper ? tanhf(mix * 2.0f) * 5.0f : softClip(mix * 2.0f) * 5.0f;
+
+    if (mix != mix || mix > 1e10f || mix < -1e10f) mix = 0;
+    return mix;
+}
+
+// Two output frames from a half-rate signal, x pointing at its newest frame
+// The even frame is the input delayed to the kernel centre; the odd frame
+// is the half-band interpolation midway to the next
+static inline void upsamplePair(const float* x, const float* kernel, float& even, float& odd) {
+    const float* base = x - (kHalfBandTaps - 1);
+    float sum = 0;
+    for (int k = 0; k < kHalfBandTaps; k++) {
+        sum += base[k] * kernel[k];
+    }
+    even = x[-kHalfBandTaps / 2];
+    odd = sum;
+}
+
+// Live Mode write-head fade for a grain about to read `spanFrames` frames
+// The head stays put while a block renders (capture runs first), so one
+// check per block covers every read the grain makes in it. Grains fade
+// within `fadeFrames` of the newest frame, or of the oldest frames that the
+// next capture will overwrite.
+static float liveProximityGain(int writePos, int length, int position, float positionDelta,
+                               int spanFrames, int fadeFrames) {
+    int distBehind = writePos - position;
+    if (distBehind < 0) distBehind += length;
+    int distAhead = length - distBehind;
+
+    int travel = (int)(spanFrames * positionDelta) + 1;  // +1 for the interpolation partner
+    int minDist = distBehind - travel;
+    if (distAhead - spanFrames < minDist) minDist = distAhead - spanFrames;
+
+    if (minDist <= 0) return 0.0f;
+    if (minDist >= fadeFrames) return 1.0f;
+    return (float)minDist / (float)fadeFrames;
+}
+
+// Live Mode frame a drifter position (0-1) maps to: 0 sits `safeDistance`
+// behind the write head, 1 reaches back to the oldest safe frame
+static inline int livePosition(int writePos, int length, int safeDistance, float position) {
+    int offsetBehind = safeDistance + (int)(position * (length - safeDistance * 2));
+    int pos = writePos - offsetBehind;
+    return (pos < 0) ? pos + length : pos;
+}
+
+// Grain position is 32.32 fixed point: whole frames above, fraction below
+static inline int grainFrame(uint64_t position) {
+    return (int)(position >> 32);
+}
+
+static inline float grainFraction(uint64_t position) {
+    return (uint32_t)position * kFixedFractionScale;
+}
+
+static inline uint64_t toGrainPosition(int frame) {
+    return (uint64_t)frame << 32;
+}
+
+// Playback rate (frames per output frame) as a 32.32 increment
+static inline uint64_t toGrainRate(float rate) {
+    return (uint64_t)((double)rate * 4294967296.0);
+}
+
+static inline float grainRate(uint64_t positionDelta) {
+    return (float)positionDelta * kFixedFractionScale;
+}
+
+// Advance a grain by one output frame, retiring it when its envelope completes
+// `lengthFixed` is the source length in 32.32 (positions only ever move forward)
+static inline void advanceGrain(Grain& grain, uint64_t lengthFixed) {
+    grain.position += grain.positionDelta;
+    if (grain.position >= lengthFixed) grain.position -= lengthFixed;
+
+    // Envelope phase is 0.32 fixed point - wrapping past 1.0 ends the grain
+    uint32_t phase = grain.phase + grain.phaseDelta;
+    if (phase < grain.phase) {
+        grain.active = false;
+    }
+    grain.phase = phase;
+}
+
+// Map density (0-100) to grains per second
+static float densityToRate(float density) {
+    // 0% -> 0.25 grains/sec (sparse!), 100% -> 50 grains/sec
+    // NOT a perfect inverse of size - allows gaps at low density
+    return 0.25f * powf(200.0f, density / 100.0f);
+}
+
+// Map density to grain size in seconds
+static float densityToSize(float density) {
+    // 0% -> 0.5s, 100% -> 100ms
+    // Less aggressive size reduction - grains stay longer
+    return 0.5f * powf(0.2f, density / 100.0f);
+}
+
+// Start an autocorrelation pitch search of a windowSize-frame window
+// Lags run from ~2000Hz down to ~60Hz, limited to half the window so enough
+// of it overlaps to correlate: a 512-frame window hears down to ~190Hz at
+// 48kHz and 1024 down to ~95Hz
+static inline void beginPitchSearch(PitchSearch& search, float sampleRate, int windowSize) {
+    int factor = (int)ceilf(sampleRate / kPitchCoarseRate);
+    int fit = (windowSize + kPitchCoarsePoints - 1) / kPitchCoarsePoints;
+    search.factor = (factor > fit) ? factor : fit;
+    search.points = 0;
+    search.minLag = (int)(sampleRate / 2000.0f);     // Max freq ~2000Hz
+    search.maxLag = (int)(sampleRate / 60.0f);       // Min freq ~60Hz
+    if (search.maxLag > windowSize / 2) search.maxLag = windowSize / 2;
+    search.lag = search.minLag / search.factor;
+    if (search.lag < 1) search.lag = 1;
+    search.endLag = (search.maxLag + search.factor - 1) / search.factor;
+    search.refining = false;
+    search.done = search.minLag >= search.maxLag;
+    search.bestLag = 0;
+    search.bestCorr = 0.0f;
+}
+
+// Normalised correlation of a window with itself `lag` frames on
+// Costs windowSize - lag multiply-adds; only a window that runs off the end
+// of the view pays for wrapping its reads
+static inline float correlateAtLag(const SampleView& view, int startPos, int windowSize, int lag) {
+    float corr = 0.0f;
+    float energy = 0.0f;
+    const int count = windowSize - lag;
+    if (startPos + windowSize <= view.length) {
+        for (int i = 0; i < count; i++) {
+            float x1 = view.read(startPos + i);
+            corr += x1 * view.read(startPos + i + lag);
+            energy += x1 * x1;
+        }
+    } else {
+        const int bufferLen = view.length;
+        for (int i = 0; i < count; i++) {
+            float x1 = view.read((startPos + i) % bufferLen);
+            corr += x1 * view.read((startPos + i + lag) % bufferLen);
+            energy += x1 * x1;
+        }
+    }
+
+    // Normalize correlation
+    if (energy > 0.0001f) {
+        corr /= energy;
+    }
+    return corr;
+}
+
+// Box-average the window down to one point per `factor` frames
+// A crude low-pass, but pitches up to 2000Hz pass it nearly untouched
+static void decimatePitchWindow(PitchSearch& search, const SampleView& view, int startPos, int windowSize) {
+    const int factor = search.factor;
+    const bool wraps = startPos + windowSize > view.length;
+    const float scale = 1.0f / factor;
+    search.points = windowSize / factor;
+    for (int i = 0; i < search.points; i++) {
+        int pos = startPos + i * factor;
+        float sum = 0.0f;
+        for (int k = 0; k < factor; k++) {
+            sum += view.read(wraps ? (pos + k) % view.length : pos + k);
+        }
+        search.coarse[i] = sum * scale;
+    }
+}
+
+// Normalised correlation of the decimated window at a lag in points
+static inline float correlateCoarse(const PitchSearch& search, int lag) {
+    float corr = 0.0f;
+    float energy = 0.0f;
+    const float* x = search.coarse;
+    for (int i = 0; i < search.points - lag; i++) {
+        corr += x[i] * x[i + lag];
+        energy += x[i] * x[i];
+    }
+    return (energy > 0.0001f) ? corr / energy : corr;
+}
+
+// Work through the search until `budget` multiply-adds are spent (always at
+// least one step: the decimation, or one lag)
+// Returns the work done; the search is over once search.done is set
+static int32_t continuePitchSearch(PitchSearch& search, const SampleView& view, int startPos, int windowSize,
+                                   int32_t budget) {
+    int32_t work = 0;
+    while (!search.done) {
+        if (search.points == 0) {
+            decimatePitchWindow(search, view, startPos, windowSize);
+            work += windowSize;
+            continue;
+        }
+
+        if (search.lag >= search.endLag) {
+            if (search.refining || search.bestCorr < kPitchConfidence) {
+                search.done = true;  // Refined, or nothing worth refining
+                break;
+            }
+            // Refine at full rate within a decimated point either side
+            int center = search.bestLag * search.factor;
+            search.lag = center - search.factor + 1;
+            if (search.lag < search.minLag) search.lag = search.minLag;
+            search.endLag = center + search.factor;
+            if (search.endLag > search.maxLag) search.endLag = search.maxLag;
+            search.refining = true;
+            search.bestLag = 0;
+            search.bestCorr = 0.0f;
+            continue;
+        }
+
+        int32_t cost = search.refining ? windowSize - search.lag : search.points - search.lag;
+        if (work > 0 && work + cost > budget) break;
+        float corr = search.refining ? correlateAtLag(view, startPos, windowSize, search.lag)
+                                     : correlateCoarse(search, search.lag);
+        work += cost;
+
+        if (corr > search.bestCorr) {
+            search.bestCorr = corr;
+            search.bestLag = search.lag;
+        } else if (!search.refining && search.bestCorr > 0.8f) {
+            // Past the first strong peak - that is the period. Its multiples
+            // correlate just as well, so searching on invites octave errors
+            search.lag = search.endLag;
+            continue;
+        }
+        search.lag++;
+    }
+    return work;
+}
+
+// Pitch a finished search found, as semitones from A4 (440Hz), or 0 if no clear pitch
+static float pitchSearchResult(const PitchSearch& search, float sampleRate) {
+    // Require reasonable correlation strength (at full rate)
+    if (!search.refining || search.bestCorr < kPitchConfidence || search.bestLag == 0) {
+        return 0.0f;  // No clear pitch detected
+    }
+
+    // Convert lag to frequency, then to semitones from A4
+    // Use log() instead of log2f() - C++ overload inlines to builtin
+    // log2(x) = log(x) / log(2) = log(x) * 1.4427f
+    float freq = sampleRate / (float)search.bestLag;
+    return 12.0f * log(freq / 440.0f) * 1.4427f;
+}
+
+// Simple autocorrelation pitch detector, searching the whole lag range at once
+// Returns detected pitch as semitones from A4 (440Hz), or 0 if no clear pitch
+// view: audio to analyze (left channel)
+// startPos: position in the view to start analysis (wraps at its length)
+static float detectPitch(const SampleView& view, int startPos, float sampleRate, int windowSize) {
+    PitchSearch search;
+    beginPitchSearch(search, sampleRate, windowSize);
+    continuePitchSearch(search, view, startPos, windowSize, INT32_MAX);
+    return pitchSearchResult(search, sampleRate);
+}
+
+// Calculate per-drifter volume based on tilt (linear approximation, avoids powf)
+static float tiltVolume(int drifterIndex, float tilt) {
+    // tilt: -1 (dark) to +1 (bright)
+    // D1 (bass) gets louder when tilt negative, D4 (air) gets louder when positive
+    float normalizedIndex = (float)drifterIndex / (kNumDrifters - 1);  // 0 to 1
+    float tiltEffect = (normalizedIndex - 0.5f) * 2.0f * tilt;  // -1 to +1 range
+    // Linear approximation of ±6dB: 1 + 0.5*x gives roughly 0.5 to 1.5 range
+    return 1.0f + tiltEffect * 0.5f;
+}
+
+// Converts a scale degree to semitones with octave wrapping
+// degree: Scale degree (can be negative or > scale size)
+// scaleIndex: Index into scales[] array (0 = chromatic)
+// Returns: Semitone offset from root
+static float degreeToSemitones(int degree, int scaleIndex) {
+    // Chromatic bypass: degrees = semitones
+    if (scaleIndex == 0) {
+        return (float)degree;
+    }
+
+    const Scale& scale = scales[scaleIndex];
+
+    // Calculate which octave we're in and degree within that octave
+    int octave = degree / (int)scale.noteCount;
+    int degreeInOctave = degree % (int)scale.noteCount;
+
+    // Handle negative modulo correctly (C++ % can give negative results)
+    if (degreeInOctave < 0) {
+        degreeInOctave += scale.noteCount;
+        octave -= 1;
+    }
+
+    // Convert to semitones: octaves + scale degree offset
+    return (float)(octave * 12 + scale.notes[degreeInOctave]);
+}
+
+// Quantizes a pitch in semitones to the nearest scale degree
+// semitones: Pitch as semitone offset from root
+// scaleIndex: Index into scales[] array (0 = chromatic)
+// Returns: Quantized semitone value
+static float quantizePitchToScale(float semitones, int scaleIndex) {
+    // Chromatic bypass: no quantization
+    if (scaleIndex == 0) {
+        return semitones;
+    }
+
+    const Scale& scale = scales[scaleIndex];
+
+    // Determine which octave and semitone within octave
+    int octave = (int)floorf(semitones / 12.0f);
+    float semisInOctave = semitones - (octave * 12.0f);
+
+    // Handle negative case
+    if (semisInOctave < 0.0f) {
+        semisInOctave += 12.0f;
+        octave -= 1;
+    }
+
+    // Find nearest scale note
+    int nearestIdx = 0;
+    float minDist = fabsf(semisInOctave - scale.notes[0]);
+
+    for (int i = 1; i < scale.noteCount; i++) {
+        float dist = fabsf(semisInOctave - scale.notes[i]);
+        if (dist < minDist) {
+            minDist = dist;
+            nearestIdx = i;
+        }
+    }
+
+    // Convert back to absolute semitones
+    return (float)(octave * 12 + scale.notes[nearestIdx]);
+}
+
+// View of a cache slot's frames
+static inline SampleView slotView(const SampleSlot& slot) {
+    SampleView view = { slot.frames, NULL, slot.packed, slot.length };
+    return view;
+}
+
+// View of the Live Mode capture buffer
+static inline SampleView liveView(const _driftEngine_DRAM* dram) {
+    SampleView view = { dram->liveBufferL, dram->liveIsStereo ? dram->liveBufferR : NULL, NULL, dram->liveLength };
+    return view;
+}
+
+// Frame i of one channel: a float channel, or the view's own (possibly
+// packed) mono storage when `data` is NULL
+static inline float readChannel(const SampleView& view, const float* data, int i) {
+    return data ? data[i] : view.read(i);
+}
+
+// Bring an index a few frames outside the view back in (reads wrap, as
+// the live buffer does)
+static inline int wrapFrame(int i, int length) {
+    return (i < 0) ? i + length : (i >= length ? i - length : i);
+}
+
+// Read one channel at pos0 + frac with a tier's interpolation
+// Kernels reading past either end of the view wrap around
+static float interpolate(const SampleView& view, const float* data, int pos0, float frac,
+                         int mode, const float (*kernel)[kInterpTaps]) {
+    int length = view.length;
+
+    if (mode == kInterpLinear) {
+        int pos1 = (pos0 + 1 < length) ? pos0 + 1 : 0;
+        return readChannel(view, data, pos0) * (1 - frac) + readChannel(view, data, pos1) * frac;
+    }
+
+    if (mode == kInterpCubic) {
+        float xm1, x0, x1, x2;
+        if (pos0 >= 1 && pos0 + 2 < length) {
+            xm1 = readChannel(view, data, pos0 - 1);
+            x0 = readChannel(view, data, pos0);
+            x1 = readChannel(view, data, pos0 + 1);
+            x2 = readChannel(view, data, pos0 + 2);
+        } else {
+            xm1 = readChannel(view, data, wrapFrame(pos0 - 1, length));
+            x0 = readChannel(view, data, pos0);
+            x1 = readChannel(view, data, wrapFrame(pos0 + 1, length));
+            x2 = readChannel(view, data, wrapFrame(pos0 + 2, length));
+        }
+        // 4-point Hermite (Catmull-Rom)
+        float c1 = 0.5f * (x1 - xm1);
+        float c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+        float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+        return ((c3 * frac + c2) * frac + c1) * frac + x0;
+    }
+
+    // Windowed sinc: blend the two nearest kernel phases
+    float phase = frac * kInterpPhases;
+    int p = (int)phase;
+    float blend = phase - p;
+    const float* k0 = kernel[p];
+    const float* k1 = kernel[p + 1];
+    int base = pos0 - (kInterpTaps / 2 - 1);
+    float sum = 0;
+    if (base >= 0 && base + kInterpTaps <= length) {
+        for (int k = 0; k < kInterpTaps; k++) {
+            sum += readChannel(view, data, base + k) * (k0[k] + (k1[k] - k0[k]) * blend);
+        }
+    } else {
+        for (int k = 0; k < kInterpTaps; k++) {
+            sum += readChannel(view, data, wrapFrame(base + k, length)) * (k0[k] + (k1[k] - k0[k]) * blend);
+        }
+    }
+    return sum;
+}
+
+// Copy one contiguous run of input into the live buffer, returning its peak
+static float captureRun(float* dstL, float* dstR, const float* srcL, const float* srcR, int count) {
+    float peak = 0;
+    for (int i = 0; i < count; i++) {
+        float amp = fabsf(srcL[i]);
+        if (amp > peak) peak = amp;
+    }
+    memcpy(dstL, srcL, count * sizeof(float));
+    if (srcR) memcpy(dstR, srcR, count * sizeof(float));
+    return peak;
+}
+
+// Append a block to the Live Mode circular buffer
+// Writes run in at most two pieces (split at the wrap) and are cut again at
+// overview column boundaries, so the scrolling overview updates as we go
+// instead of being rescanned. Pass srcR = NULL for mono capture.
+static void captureLive(_driftEngine_DTC* dtc, _driftEngine_DRAM* dram,
+                        const float* srcL, const float* srcR, int numFrames) {
+    int32_t length = dram->liveLength;
+    int writePos = dtc->writePointer;
+
+    while (numFrames > 0) {
+        int px = (int)((int64_t)writePos * kWaveformOverviewWidth / length);
+        int pixelEnd = (int)(((int64_t)(px + 1) * length + kWaveformOverviewWidth - 1) / kWaveformOverviewWidth);
+        int count = pixelEnd - writePos;
+        if (count > numFrames) count = numFrames;
+
+        float peak = captureRun(dram->liveBufferL + writePos, dram->liveBufferR + writePos, srcL, srcR, count);
+
+        if (px != dtc->captureOverviewPixel) {
+            dtc->captureOverviewPixel = px;
+            dtc->captureOverviewPeak = 0;
+        }
+        if (peak > dtc->captureOverviewPeak) dtc->captureOverviewPeak = peak;
+        dram->liveOverview[px] = dtc->captureOverviewPeak;
+
+        srcL += count;
+        if (srcR) srcR += count;
+        numFrames -= count;
+        writePos += count;
+        if (writePos >= length) writePos = 0;
+    }
+
+    dtc->writePointer = writePos;
+}
+
+static inline uint16_t toFeatureLevel(float x) {
+    return (uint16_t)(fminf(1.0f, x) * 65535.0f + 0.5f);
+}
+
+static inline float fromFeatureLevel(uint16_t x) {
+    return x * (1.0f / 65535.0f);
+}
+
+// Analyse bins [fromBin, toBin) of a sample into its feature map
+// Bins must be analysed in order - onset compares against the previous bin
+static void analyseFeatureBins(const SampleView& view, FeatureBin* features, int fromBin, int toBin) {
+    for (int bin = fromBin; bin < toBin; bin++) {
+        int start = bin << kFeatureBinShift;
+        int end = start + kFeatureBinFrames;
+        if (end > view.length) end = view.length;
+
+        float sumSq = 0;
+        float peak = 0;
+        for (int s = start; s < end; s++) {
+            float x = view.read(s);
+            sumSq += x * x;
+            float amp = fabsf(x);
+            if (amp > peak) peak = amp;
+        }
+        float rms = (end > start) ? sqrtf(sumSq / (end - start)) : 0;
+        float prevRms = (bin > 0) ? fromFeatureLevel(features[bin - 1].rms) : 0;
+
+        FeatureBin& f = features[bin];
+        f.rms = toFeatureLevel(rms);
+        f.peak = toFeatureLevel(peak);
+        f.onset = toFeatureLevel(fmaxf(0, rms - prevRms));
+        f.silentRun = (peak < kSilenceThreshold) ? 1 : 0;
+    }
+}
+
+// Turn per-bin silence flags into run lengths (after all bins are analysed)
+// A grain whose whole read span fits in the run can be skipped outright
+static void linkSilentRuns(FeatureBin* features, int numBins) {
+    uint32_t run = 0;
+    for (int bin = numBins - 1; bin >= 0; bin--) {
+        run = features[bin].silentRun ? run + 1 : 0;
+        features[bin].silentRun = (uint16_t)(run > 65535 ? 65535 : run);
+    }
+}
+
+// Waveform overview from the feature map peaks (no pass over the frames)
+static void overviewFromFeatures(const FeatureBin* features, int numBins, float* overview) {
+    for (int px = 0; px < kWaveformOverviewWidth; px++) {
+        int startBin = (px * numBins) / kWaveformOverviewWidth;
+        int endBin = ((px + 1) * numBins) / kWaveformOverviewWidth;
+        if (endBin <= startBin) endBin = startBin + 1;
+        if (endBin > numBins) endBin = numBins;
+
+        uint16_t maxPeak = 0;
+        for (int bin = startBin; bin < endBin; bin++) {
+            if (features[bin].peak > maxPeak) maxPeak = features[bin].peak;
+        }
+        overview[px] = fromFeatureLevel(maxPeak);
+    }
+}
+
+// Index zero crossings for blocks [fromBlock, toBlock) of a sample
+// Each block records the offset of its quietest sign change, or kNoZeroCross
+static void indexZeroCrossings(const SampleView& view, uint8_t* index, int fromBlock, int toBlock) {
+    for (int block = fromBlock; block < toBlock; block++) {
+        int start = block << kZeroCrossShift;
+        int end = start + kZeroCrossBlockFrames;
+        if (end > view.length) end = view.length;
+
+        uint8_t best = kNoZeroCross;
+        float bestAmp = 2.0f;
+        float prev = (start > 0) ? view.read(start - 1) : 0;
+        for (int s = start; s < end; s++) {
+            float cur = view.read(s);
+            if (prev * cur < 0) {
+                // Take whichever side of the crossing is closer to zero
+                bool usePrev = fabsf(prev) < fabsf(cur) && s > start;
+                float amp = usePrev ? fabsf(prev) : fabsf(cur);
+                if (amp < bestAmp) {
+                    bestAmp = amp;
+                    best = (uint8_t)(s - start - (usePrev ? 1 : 0));
+                }
+            }
+            prev = cur;
+        }
+        index[block] = best;
+    }
+}
+
+// Nearest indexed zero crossing within searchRadius of startPos, or -1
+// Scans outward block by block, so the cost is a handful of byte reads
+static int lookupZeroCrossing(const uint8_t* index, int numBlocks, int startPos, int searchRadius) {
+    int home = startPos >> kZeroCrossShift;
+    int reach = (searchRadius >> kZeroCrossShift) + 1;
+    int bestPos = startPos;  // No crossing in reach - stay put
+    int bestDist = searchRadius + 1;
+
+    for (int offset = 0; offset <= reach; offset++) {
+        for (int side = 0; side < 2; side++) {
+            if (offset == 0 && side == 1) continue;
+            int block = side ? home - offset : home + offset;
+            if (block < 0 || block >= numBlocks || index[block] == kNoZeroCross) continue;
+            int pos = (block << kZeroCrossShift) + index[block];
+            int dist = (pos > startPos) ? pos - startPos : startPos - pos;
+            if (dist < bestDist) {
+                bestDist = dist;
+                bestPos = pos;
+            }
+        }
+        // Blocks further out can't beat a crossing already this close
+        if (bestDist <= (offset << kZeroCrossShift)) break;
+    }
+    return bestPos;
+}
+
+// Where a pitch map bin's detector window starts: the middle of the bin
+static inline int pitchWindowStart(const SampleView& view, int bin) {
+    return ((bin << kPitchBinShift) + (kPitchBinFrames - kPitchMapWindow) / 2) % view.length;
+}
+
+// Store a finished search as a pitch map bin
+static void storePitchBin(PitchBin& bin, const PitchSearch& search, float sampleRate) {
+    bin.pitch = (int16_t)(pitchSearchResult(search, sampleRate) * 256.0f);
+    bin.confidence = search.refining ? toFeatureLevel(fmaxf(0.0f, search.bestCorr)) : 0;
+}
+
+// Pitch at a frame from a pitch map (0 = no clear pitch, as detectPitch)
+static inline float lookupPitch(const PitchBin* map, int numBins, int pos) {
+    int bin = pos >> kPitchBinShift;
+    if (bin >= numBins || map[bin].confidence < toFeatureLevel(kPitchConfidence)) return 0.0f;
+    return map[bin].pitch * (1.0f / 256.0f);
+}
+
+// Find the cache slot holding a fully loaded sample, or -1
+static inline int findCachedSample(const _driftEngine_DRAM* dram, int folder, int sample) {
+    for (int i = 0; i < dram->numSlots; i++) {
+        const SampleSlot& slot = dram->slots[i];
+        if (slot.folder == folder && slot.sample == sample && slot.length > 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Pick the slot a new load goes into: an empty slot, else the least recently used
+// The playing slot is only reused when it is the only one
+static inline int chooseVictimSlot(const _driftEngine_DRAM* dram) {
+    int victim = -1;
+    for (int i = 0; i < dram->numSlots; i++) {
+        if (i == dram->activeSlot && dram->numSlots > 1) continue;
+        const SampleSlot& slot = dram->slots[i];
+        if (slot.folder < 0 && slot.length == 0) return i;
+        if (victim < 0 || slot.lastUsed < dram->slots[victim].lastUsed) {
+            victim = i;
+        }
+    }
+    return victim;
+}
+
+// Make a slot the one sample mode plays from (no I/O)
+static void activateSlot(_driftEngine_DRAM* dram, int index) {
+    dram->activeSlot = index;
+    dram->slots[index].lastUsed = ++dram->useCounter;
+}
+
+// Build a windowed-sinc polyphase kernel of (phases + 1) rows of `taps`
+// Row p holds the taps for a fractional position of p / phases; tap k
+// weighs the frame k - (taps/2 - 1) from the integer position
+static void buildSincKernel(float* kernel, int taps, int phases, float cutoff) {
+    const int half = taps / 2;
+
+    for (int p = 0; p <= phases; p++) {
+        float* row = kernel + p * taps;
+        float frac = (float)p / phases;
+        float sum = 0;
+        for (int k = 0; k < taps; k++) {
+            float d = (float)(k - (half - 1)) - frac;   // Distance from the output point
+            float x = 2.0f * M_PI * cutoff * d;
+            float sinc = (fabsf(x) < 1e-6f) ? 1.0f : sinf(x) / x;
+            // Blackman window over the kernel span
+            float w = (d + half) / (float)taps;
+            float window = 0.42f - 0.5f * cosf(2.0f * M_PI * w) + 0.08f * cosf(4.0f * M_PI * w);
+            float tap = sinc * fmaxf(0.0f, window);
+            row[k] = tap;
+            sum += tap;
+        }
+        // Unity DC gain for every phase
+        for (int k = 0; k < taps; k++) {
+            row[k] /= sum;
+        }
+    }
+}
+
+// Build the resampling kernel for a conversion ratio
+// The cutoff drops below the output Nyquist when downsampling
+static inline void buildResampleKernel(_driftEngine_DRAM* dram, float inRate, float outRate) {
+    float cutoff = 0.45f * fminf(1.0f, outRate / inRate);  // Cycles per input frame
+    buildSincKernel(&dram->resampleKernel[0][0], kResampleTaps, kResamplePhases, cutoff);
+}
+
+// Post a job from step() - returns false when the ring is full
+static bool postJob(JobQueue& queue, uint8_t type, int slot, uint32_t generation) {
+    uint32_t head = queue.head;
+    if (head - queue.tail >= (uint32_t)kJobQueueSize) return false;
+
+    Job& job = queue.jobs[head & (kJobQueueSize - 1)];
+    job.type = type;
+    job.slot = (int8_t)slot;
+    job.generation = generation;
+    __sync_synchronize();  // Publish the job before the index that exposes it
+    queue.head = head + 1;
+    return true;
+}
+
+// Resolve what a job works on: the audio, its maps, and (slots only) its overview
+// Returns NULL when the target has changed since the job was posted
+static AnalysisMaps* jobTarget(_driftEngine_DRAM* dram, float liveRate, const Job& job, SampleView& view,
+                               float& sampleRate, float*& overview) {
+    AnalysisMaps* maps;
+    if (job.slot == kJobLive) {
+        maps = &dram->liveMaps;
+        view = liveView(dram);
+        view.right = NULL;  // Analysis runs on the left channel
+        sampleRate = liveRate;
+        overview = NULL;    // Capture keeps the live overview current
+    } else {
+        SampleSlot& slot = dram->slots[job.slot];
+        maps = &slot.maps;
+        view = slotView(slot);
+        sampleRate = slot.sampleRate;
+        overview = slot.waveformOverview;
+    }
+    return (maps->generation == job.generation) ? maps : NULL;
+}
+
+// Record the current job as done for the generation it was posted for
+// step() may have moved on meanwhile - then the record never matches and
+// nothing is published (see publishFinishedJobs)
+static void finishJob(DriftEngine* engine, AnalysisMaps* maps) {
+    const Job& job = engine->currentJob;
+    __sync_synchronize();  // The map is complete before it is recorded
+    if (maps->finishedGeneration != job.generation) {
+        maps->finishedJobs = 0;
+        maps->finishedGeneration = job.generation;
+    }
+    maps->finishedJobs |= (uint8_t)(1 << job.type);
+    engine->jobRunning = false;
+}
+
+// Work through up to `budget` frames of the current job
+// Returns the frames of work done; clears jobRunning when the job completes
+static int32_t runJobSlice(DriftEngine* engine, int32_t budget) {
+    const Job& job = engine->currentJob;
+    SampleView view;
+    float sampleRate;
+    float* overview;
+    AnalysisMaps* maps = jobTarget(engine->dram, engine->sampleRate, job, view, sampleRate, overview);
+    if (!maps) {
+        // Evicted or unfrozen - drop
+        engine->jobRunning = false;
+        return 0;
+    }
+
+    switch (job.type) {
+        case kJobFeatureMap: {
+            int32_t total = featureBinsForFrames(view.length);
+            int32_t count = budget >> kFeatureBinShift;
+            if (count < 1) count = 1;
+            if (count > total - engine->jobProgress) count = total - engine->jobProgress;
+            analyseFeatureBins(view, maps->features, engine->jobProgress, engine->jobProgress + count);
+            engine->jobProgress += count;
+            if (engine->jobProgress < total) {
+                return count << kFeatureBinShift;
+            }
+
+            // Complete - finish the map and derive the overview
+            linkSilentRuns(maps->features, total);
+            if (overview) overviewFromFeatures(maps->features, total, overview);
+            finishJob(engine, maps);
+            return count << kFeatureBinShift;
+        }
+
+        case kJobZeroCrossIndex: {
+            int32_t total = zeroCrossBlocksForFrames(view.length);
+            int32_t count = budget >> kZeroCrossShift;
+            if (count < 1) count = 1;
+            if (count > total - engine->jobProgress) count = total - engine->jobProgress;
+            indexZeroCrossings(view, maps->zeroCrossings, engine->jobProgress, engine->jobProgress + count);
+            engine->jobProgress += count;
+            if (engine->jobProgress < total) {
+                return count << kZeroCrossShift;
+            }
+            finishJob(engine, maps);
+            return count << kZeroCrossShift;
+        }
+
+        case kJobPitchMap: {
+            // A bin's search can span slices - work is counted in correlation
+            // terms, and a slice stops between lags once its budget is spent
+            int32_t total = pitchBinsForFrames(view.length);
+            PitchSearch& search = engine->pitchSearch;
+            int32_t work = 0;
+            while (engine->jobProgress < total && work < budget) {
+                int bin = engine->jobProgress;
+                int start = pitchWindowStart(view, bin);
+                if (!engine->pitchBinOpen) {
+                    beginPitchSearch(search, sampleRate, kPitchMapWindow);
+                    engine->pitchBinOpen = true;
+                }
+                work += continuePitchSearch(search, view, start, kPitchMapWindow, budget - work);
+                if (!search.done) break;  // Budget spent mid-bin
+                storePitchBin(maps->pitchMap[bin], search, sampleRate);
+                engine->pitchBinOpen = false;
+                engine->jobProgress++;
+            }
+            if (engine->jobProgress < total) {
+                return work;
+            }
+            finishJob(engine, maps);
+            return work;
+        }
+    }
+
+    // Unknown job
+    engine->jobRunning = false;
+    return 0;
+}
+
+// Consume jobs for up to `budget` frames of work
+static void runJobs(DriftEngine* engine, int32_t budget) {
+    JobQueue& queue = engine->jobs;
+    while (budget > 0) {
+        if (!engine->jobRunning) {
+            uint32_t tail = queue.tail;
+            if (tail == queue.head) return;  // Idle
+            __sync_synchronize();  // Read the job after seeing the index
+            engine->currentJob = queue.jobs[tail & (kJobQueueSize - 1)];
+            queue.tail = tail + 1;
+            engine->jobProgress = 0;
+            engine->pitchBinOpen = false;
+            engine->jobRunning = true;
+        }
+        int32_t done = runJobSlice(engine, budget);
+        budget -= (done > 0) ? done : 1;
+    }
+}
+
+// Post whichever of `wanted` (JobType bits) a target's maps still lack,
+// in `order` - whatever doesn't fit in the ring is posted on a later block
+static void postAnalysisJobs(JobQueue& queue, AnalysisMaps& maps, int target, const uint8_t* order,
+                             uint8_t wanted) {
+    for (int i = 0; i < kNumJobTypes; i++) {
+        uint8_t bit = (uint8_t)(1 << order[i]);
+        if (!(wanted & bit) || (maps.jobsPosted & bit)) continue;
+        if (!postJob(queue, order[i], target, maps.generation)) return;
+        maps.jobsPosted |= bit;
+    }
+}
+
+// Publish the maps of a target whose jobs have finished for its current audio
+static void publishFinishedJobs(AnalysisMaps& maps, int32_t frames) {
+    if (maps.finishedGeneration != maps.generation) return;
+    __sync_synchronize();  // Read the maps after seeing the record
+    uint8_t finished = maps.finishedJobs & maps.jobsPosted;
+    if (finished & (1 << kJobFeatureMap)) maps.numFeatureBins = featureBinsForFrames(frames);
+    if (finished & (1 << kJobZeroCrossIndex)) maps.numZeroCrossBlocks = zeroCrossBlocksForFrames(frames);
+    if (finished & (1 << kJobPitchMap)) maps.numPitchBins = pitchBinsForFrames(frames);
+}
+
+// Producer side, once per step: publish finished work and post work that became due
+// The pitch map only matters to a selected scale, so it waits for one
+// Falls back to consuming a small slice itself if draw() has stopped calling
+static void serviceJobs(DriftEngine* engine, int numFrames, bool wantPitch) {
+    static const uint8_t slotOrder[kNumJobTypes] = { kJobFeatureMap, kJobZeroCrossIndex, kJobPitchMap };
+    static const uint8_t liveOrder[kNumJobTypes] = { kJobZeroCrossIndex, kJobFeatureMap, kJobPitchMap };
+    _driftEngine_DRAM* dram = engine->dram;
+    JobQueue& queue = engine->jobs;
+    uint8_t wanted = (1 << kJobFeatureMap) | (1 << kJobZeroCrossIndex) | (wantPitch ? 1 << kJobPitchMap : 0);
+
+    // The playing slot, once loaded (a slot mid-load has no folder yet)
+    if (dram->activeSlot >= 0) {
+        SampleSlot& slot = dram->slots[dram->activeSlot];
+        if (slot.folder >= 0 && slot.length > 0) {
+            publishFinishedJobs(slot.maps, slot.length);
+            postAnalysisJobs(queue, slot.maps, dram->activeSlot, slotOrder, wanted);
+        }
+    }
+
+    // Freezing makes the live buffer static - give it the sample-mode maps
+    if (engine->dtc->frozen && dram->liveCaptured) {
+        publishFinishedJobs(dram->liveMaps, dram->liveLength);
+        postAnalysisJobs(queue, dram->liveMaps, kJobLive, liveOrder, wanted);
+    }
+
+    engine->framesSinceDrawJobs += numFrames;
+    if (engine->framesSinceDrawJobs > (int32_t)engine->sampleRate / 10 && !engine->jobConsumerBusy) {
+        runJobs(engine, kStepJobBudget);
+    }
+}
+
+
+// ============================================================================
+// ENGINE
+// ============================================================================
+
+// Bytes of storage per cached frame
+static int32_t slotBytesPerFrame(const EngineConfig& config) {
+    return config.packed ? sizeof(int16_t) : sizeof(float);
+}
+
+// DRAM an instance needs: the struct, then the live buffer and its maps,
+// the cache slots and theirs, and the resampler's staging area
+static inline uint32_t engineDramBytes(const EngineConfig& config) {
+    uint32_t bytes = sizeof(_driftEngine_DRAM) +
+                     2 * config.liveFrames * sizeof(float) +
+                     analysisBytes(config.liveFrames) +
+                     config.cacheSlots * (config.slotFrames * slotBytesPerFrame(config) +
+                                          analysisBytes(config.slotFrames));
+    if (config.storageRate > 0) {
+        bytes += (kResampleTaps + kLoadChunkFrames + kResampleTaps) * sizeof(float);
+    }
+    return bytes;
+}
+
+// Set up an instance in sizeof(_driftEngine_DTC) bytes of DTC and
+// engineDramBytes(config) bytes of DRAM
+static inline void engineInit(DriftEngine* engine, void* dtcMemory, uint8_t* dramMemory, const EngineConfig& config) {
+    _driftEngine_DTC* dtc = (_driftEngine_DTC*)dtcMemory;
+    _driftEngine_DRAM* dram = (_driftEngine_DRAM*)dramMemory;
+
+    // Initialize DTC
+    memset(dtc, 0, sizeof(_driftEngine_DTC));
+    dtc->randState = seedState(config.seed);
+#ifdef DRIFTERS_PROFILE
+    profileStartTimer();
+#endif
+    dtc->smoothNorm = 1.0f;       // Start at unity gain
+
+    // Initialize smoothed values to defaults (avoid boundary collapse during ramp-up)
+    dtc->anchorSmooth = 0.5f;     // Match default anchor (50%)
+    dtc->driftSmooth = 0.3f;      // Match default drift (30%)
+    dtc->densitySmooth = 8.0f;    // Match densityToRate(50)
+    dtc->entropySmooth = 0.25f;   // Match default entropy (25%)
+
+    // Initialize crossfade state (50ms at 48kHz = 2400 samples)
+    dtc->crossfadeActive = false;
+    dtc->crossfadeSamples = 0.05f * 48000.0f;  // Will be updated with actual sample rate
+    dtc->crossfadeCounter = 0;
+    dtc->sampleModeGain = 1.0f;  // Start with sample mode active
+    dtc->liveModeGain = 0.0f;
+
+    // Initialize drifters with spread positions
+    for (int i = 0; i < kNumDrifters; i++) {
+        dtc->drifters[i].position = 0.25f + i * 0.15f;  // Spread across sample
+        dtc->drifters[i].velocity = 0;
+        dtc->drifters[i].pitchOffset = 0;
+        dtc->drifters[i].timeSinceGrain = 0;
+        dtc->drifters[i].nextGrainTime = randFloat(dtc) * 0.5f;  // Stagger initial grains
+        dtc->drifters[i].variation = 0.5f + randFloat(dtc) * 0.5f;  // 0.5-1.0, set once
+        dtc->drifters[i].driftDirection = (i % 2 == 0) ? 1.0f : -1.0f;  // Alternate directions
+        dtc->drifters[i].boredom = 0;
+        dtc->drifters[i].lastSignificantPos = dtc->drifters[i].position;
+    }
+
+    // Carve the live buffer from the DRAM following the struct
+    int32_t liveFrames = config.liveFrames;
+    dram->liveBufferL = (float*)(dramMemory + sizeof(_driftEngine_DRAM));
+    dram->liveBufferR = dram->liveBufferL + liveFrames;
+    memset(dram->liveBufferL, 0, 2 * liveFrames * sizeof(float));
+    dram->liveCapacity = liveFrames;
+    dram->liveLength = 0;
+    dram->liveCaptured = false;
+    dram->liveIsStereo = false;
+
+    // Its analysis maps (filled in while frozen)
+    memset(&dram->liveMaps, 0, sizeof(dram->liveMaps));
+    uint8_t* mapMemory = carveAnalysisMaps(dram->liveMaps, (uint8_t*)(dram->liveBufferR + liveFrames), liveFrames);
+
+    // Then the sample cache slots
+    int32_t slotFrames = config.slotFrames;
+    bool packed = config.packed;
+    uint8_t* slotMemory = mapMemory;
+    dram->numSlots = config.cacheSlots;
+    dram->activeSlot = -1;
+    dram->useCounter = 0;
+    for (int i = 0; i < kMaxCacheSlots; i++) {
+        SampleSlot& slot = dram->slots[i];
+        memset(&slot, 0, sizeof(slot));
+        slot.folder = -1;
+        slot.sample = -1;
+        slot.sampleRate = 48000.0f;
+        if (i < dram->numSlots) {
+            slot.capacity = slotFrames;
+            if (packed) {
+                slot.packed = (int16_t*)slotMemory;
+            } else {
+                slot.frames = (float*)slotMemory;
+            }
+            slotMemory += slotFrames * slotBytesPerFrame(config);
+        }
+    }
+
+    // Analysis maps follow the frame storage
+    for (int i = 0; i < dram->numSlots; i++) {
+        slotMemory = carveAnalysisMaps(dram->slots[i].maps, slotMemory, slotFrames);
+    }
+
+    // Resampling staging area follows the slots
+    dram->storageRate = config.storageRate;
+    dram->resampleStaging = (dram->storageRate > 0) ? (float*)slotMemory : NULL;
+
+    // Grain rendering tables for the quality tiers
+    buildSincKernel(&dram->interpKernel[0][0], kInterpTaps, kInterpPhases, 0.45f);
+    buildEnvelopeTables(dram);
+
+    // Half-band upsampler: the midpoint phase of a two-phase sinc kernel
+    float halfBandRows[3][kHalfBandTaps];
+    buildSincKernel(&halfBandRows[0][0], kHalfBandTaps, 2, 0.45f);
+    memcpy(dtc->halfBand, halfBandRows[1], sizeof(dtc->halfBand));
+
+    engine->dtc = dtc;
+    engine->dram = dram;
+    engine->sampleRate = 48000.0f;  // Until the first block says otherwise
+
+    // Background jobs
+    engine->jobs.head = 0;
+    engine->jobs.tail = 0;
+    engine->jobRunning = false;
+    engine->jobProgress = 0;
+    engine->pitchBinOpen = false;
+    engine->jobConsumerBusy = false;
+    engine->framesSinceDrawJobs = 0;
+}
+
+// A slot's frames are in place (slot.folder/sample set by the loader):
+// make it the one sample mode plays and queue its analysis
+static inline void engineSlotLoaded(DriftEngine* engine, int index, int32_t length, float sampleRate) {
+    _driftEngine_DRAM* dram = engine->dram;
+    SampleSlot& slot = dram->slots[index];
+    slot.length = length;
+    slot.sampleRate = sampleRate;
+
+    // Analysis maps and the overview are built by background jobs; whatever
+    // was analysed for the slot before belongs to other audio
+    slot.maps.generation++;
+    slot.maps.numFeatureBins = 0;
+    slot.maps.numZeroCrossBlocks = 0;
+    slot.maps.numPitchBins = 0;
+    slot.maps.jobsPosted = 0;
+    memset(slot.waveformOverview, 0, sizeof(slot.waveformOverview));
+
+    activateSlot(dram, index);
+}
+
+// Background analysis for up to `budget` frames of work, off the audio path
+static inline void engineRunJobs(DriftEngine* engine, int32_t budget) {
+    engine->jobConsumerBusy = true;
+    runJobs(engine, budget);
+    engine->framesSinceDrawJobs = 0;
+    engine->jobConsumerBusy = false;
+}
+
+// Render one block
+static inline void engineRender(DriftEngine* engine, const EngineParams& p, const EngineBuffers& b) {
+    _driftEngine_DTC* dtc = engine->dtc;
+    _driftEngine_DRAM* dram = engine->dram;
+
+    const int numFrames = b.numFrames;
+    const float sr = b.sampleRate;
+    engine->sampleRate = sr;
+#ifdef DRIFTERS_PROFILE
+    profileBeginBlock(dtc->profile);
+#endif
+
+    // Post background analysis (draw() does the work)
+    serviceJobs(engine, numFrames, p.scale > 0);
+
+    float* outL = b.outL;
+    float* outR = b.outR;
+    const bool replaceL = b.replaceL;
+    const bool replaceR = b.replaceR;
+    const float* cvAnchor = b.cvAnchor;
+    const float* cvPitch = b.cvPitch;
+    const float* cvDrift = b.cvDrift;
+    const float* cvEntropy = b.cvEntropy;
+    const float* cvStorm = b.cvStorm;
+    const float* cvClock = b.cvClock;
+    float* cvOutPos = b.cvOutPosition;
+    float* cvOutPulse = b.cvOutPulse;
+    float* cvOutTelemetry = b.cvOutTelemetry;
+    const int telemetryMode = p.telemetry;
+
+    // Live Mode
+    const bool liveMode = p.liveMode;
+    const bool freezeGate = p.freeze;
+    const float* inputL = b.inputL;
+    const float* inputR = b.inputR;
+
+    // Handle freeze state
+    // A frozen buffer holds still long enough to analyse (serviceJobs posts
+    // the work); its maps stay valid until capture writes over it
+    dtc->frozen = freezeGate;
+
+    // Update crossfade duration for actual sample rate
+    dtc->crossfadeSamples = 0.05f * sr;  // 50ms crossfade
+
+    // Detect mode change and start crossfade
+    if (liveMode != dtc->prevLiveMode) {
+        dtc->crossfadeActive = true;
+        dtc->crossfadeCounter = 0;
+        dtc->prevLiveMode = liveMode;
+    }
+
+    // Update crossfade gains (block-rate update for efficiency)
+    if (dtc->crossfadeActive) {
+        float fadeProgress = dtc->crossfadeCounter / dtc->crossfadeSamples;
+        fadeProgress = fminf(fadeProgress, 1.0f);
+
+        if (liveMode) {
+            // Transitioning TO Live Mode: sample fades out, live fades in
+            dtc->sampleModeGain = 1.0f - fadeProgress;
+            dtc->liveModeGain = fadeProgress;
+        } else {
+            // Transitioning FROM Live Mode: live fades out, sample fades in
+            dtc->sampleModeGain = fadeProgress;
+            dtc->liveModeGain = 1.0f - fadeProgress;
+        }
+
+        dtc->crossfadeCounter += numFrames;
+        if (dtc->crossfadeCounter >= dtc->crossfadeSamples) {
+            dtc->crossfadeActive = false;
+            // Set final gains
+            dtc->sampleModeGain = liveMode ? 0.0f : 1.0f;
+            dtc->liveModeGain = liveMode ? 1.0f : 0.0f;
+        }
+    }
+
+    // In Live Mode, capture audio to circular buffer
+    PROFILE_MARK(kStageSetup);
+    bool hasInput = (inputL != NULL || inputR != NULL);
+    if (liveMode && hasInput && !dtc->frozen) {
+        // New audio invalidates the maps of the last freeze. Freezing again
+        // with nothing captured in between keeps them, so isn't re-analysed
+        AnalysisMaps& maps = dram->liveMaps;
+        if (maps.jobsPosted) {
+            maps.generation++;
+            maps.numFeatureBins = 0;
+            maps.numZeroCrossBlocks = 0;
+            maps.numPitchBins = 0;
+            maps.jobsPosted = 0;
+        }
+
+        // In Live Mode, ensure we have valid buffer settings
+        if (!dram->liveCaptured) {
+            dram->liveLength = dram->liveCapacity;
+            dram->liveCaptured = true;
+        }
+        // A single connected input is captured once and read back as mono
+        dram->liveIsStereo = (inputL != NULL && inputR != NULL);
+        captureLive(dtc, dram, inputL ? inputL : inputR, dram->liveIsStereo ? inputR : NULL, numFrames);
+    }
+    PROFILE_MARK(kStageCapture);
+
+    // Grains read from the live buffer or from the active cache slot
+    GrainSource sources[kNumGrainSources];
+    memset(sources, 0, sizeof(sources));
+    sources[kSourceLive].sampleRate = sr;  // Live capture runs at the NT rate
+    if (dram->liveCaptured) {
+        sources[kSourceLive].view = liveView(dram);
+        if (dtc->frozen) {
+            attachMaps(sources[kSourceLive], dram->liveMaps);
+        }
+    }
+    sources[kSourceSample].sampleRate = 48000.0f;
+    if (dram->activeSlot >= 0) {
+        const SampleSlot& slot = dram->slots[dram->activeSlot];
+        GrainSource& source = sources[kSourceSample];
+        source.view = slotView(slot);
+        source.sampleRate = slot.sampleRate;
+        attachMaps(source, slot.maps);
+    }
+
+    // New grains come from the current mode's source
+    const uint8_t currentSource = liveMode ? kSourceLive : kSourceSample;
+    const SampleView& view = sources[currentSource].view;
+    const float sourceSampleRate = sources[currentSource].sampleRate;
+    const FeatureBin* features = sources[currentSource].features;
+    const int32_t numFeatureBins = sources[currentSource].numFeatureBins;
+    const uint8_t* zeroCrossings = sources[currentSource].zeroCrossings;
+    const int32_t numZeroCrossBlocks = sources[currentSource].numZeroCrossBlocks;
+    const PitchBin* pitchMap = sources[currentSource].pitchMap;
+    const int32_t numPitchBins = sources[currentSource].numPitchBins;
+    bool livePitchMeasured = false;    // A running live buffer gets one pitch search per block
+
+    // Check if sample loaded (or Live Mode active)
+    if (view.length < 100) {
+        // Output silence
+        for (int i = 0; i < numFrames; i++) {
+            if (replaceL) outL[i] = 0;
+            if (replaceR) outR[i] = 0;
+            if (cvOutPos) cvOutPos[i] = 0;
+            if (cvOutPulse) cvOutPulse[i] = 0;
+        }
+        telemetryEndBlock(dtc->telemetry, dtc->shownTelemetry, numFrames, cvOutTelemetry, telemetryMode, sr);
+#ifdef DRIFTERS_PROFILE
+        PROFILE_MARK(kStageOutput);
+        profileEndBlock(dtc->profile, numFrames, sr);
+#endif
+        return;
+    }
+
+    float sampleLen = (float)view.length;
+
+    // Quality tier: rendering choices and control rate for this block
+    const int quality = p.quality;
+    const QualityTier& tier = kQualityTiers[quality];
+
+    // Half rate: the engine renders numFrames / 2 frames into the scratch
+    // buffer (after kHalfBandTaps frames of history), upsampled at the end
+    int engineStep = 1;
+    float* wetL = NULL;
+    float* wetR = NULL;
+    if (tier.halfRate && b.scratch &&
+        2 * (kHalfBandTaps + numFrames / 2) * sizeof(float) <= b.scratchBytes) {
+        engineStep = 2;
+        wetL = b.scratch + kHalfBandTaps;
+        wetR = wetL + numFrames / 2 + kHalfBandTaps;
+        if (!dtc->halfRateActive) {
+            memset(dtc->upsampleHistoryL, 0, sizeof(dtc->upsampleHistoryL));
+            memset(dtc->upsampleHistoryR, 0, sizeof(dtc->upsampleHistoryR));
+        }
+        memcpy(wetL - kHalfBandTaps, dtc->upsampleHistoryL, sizeof(dtc->upsampleHistoryL));
+        memcpy(wetR - kHalfBandTaps, dtc->upsampleHistoryR, sizeof(dtc->upsampleHistoryR));
+    }
+    dtc->halfRateActive = (engineStep > 1);
+    const int engineFrames = numFrames / engineStep;
+    const float engineRate = sr / engineStep;
+    const float dt = 1.0f / engineRate;
+
+    const int controlDivisor = tier.controlDivisor;
+    const float controlDt = dt * controlDivisor;
+
+    // Live grains sit at least Min delay behind the frames they play against
+    // A grain that far behind the write head reads this block's input
+    // delayed by Min delay, so the floor is one block plus that
+    int liveMinDelay = (int)(p.minDelay * sr * 0.0001f);  // Tenths of ms to frames
+    int liveSafeDistance = numFrames + 1 + liveMinDelay;
+    int liveFadeFrames = (liveMinDelay < 1) ? 1 : (liveMinDelay > 384 ? 384 : liveMinDelay);
+
+    // Write-head proximity for live grains, once per grain per block
+    const SampleView& live = sources[kSourceLive].view;
+    if (live.length >= 100) {
+        for (int g = 0; g < kMaxTotalGrains; g++) {
+            Grain& grain = dtc->grains[g];
+            if (!grain.active || grain.source != kSourceLive) continue;
+            float target = liveProximityGain(dtc->writePointer, live.length, grainFrame(grain.position),
+                                             grainRate(grain.positionDelta), engineFrames, liveFadeFrames);
+            grain.proximityStep = (target - grain.proximityGain) / engineFrames;
+        }
+    }
+
+
+    // Per-frame rates compounded over one control update, counted in host
+    // frames so the half-rate engine moves as fast as the others
+    const int controlFrames = controlDivisor * engineStep;
+    const float smoothRate = 1.0f - powf(1.0f - 0.001f, (float)controlFrames);
+    const float stormDecay = powf(0.9999f, (float)controlFrames);
+    const float velocityDamping = powf(0.995f, (float)controlFrames);
+    const float walkScale = sqrtf((float)controlFrames);  // Random kicks add in power
+    const float normRate = (engineStep > 1) ? 1.0f - powf(1.0f - 0.001f, (float)engineStep) : 0.001f;
+
+    const float wander = p.wander / 100.0f;
+    // Spectrum filter and tilt settings per drifter bus for this block
+    const float spectrumSep = p.spectrum / 100.0f;
+    const float filterQ = 1.0f + spectrumSep * 2.0f;  // Q from 1 to 3
+    const bool grainFilter = spectrumSep > 0.01f && tier.perGrainFilter;
+    const bool busFilter = spectrumSep > 0.01f && !tier.perGrainFilter;
+    const float tiltAmount = p.tilt / 100.0f;
+    float filterCoeff[kNumDrifters];
+    float busGain[kNumDrifters];
+    for (int d = 0; d < kNumDrifters; d++) {
+        filterCoeff[d] = BandFilter::coefficient(kBandCenterFreqs[d], engineRate);
+        busGain[d] = tiltVolume(d, tiltAmount);
+        if (spectrumSep > 0.01f) busGain[d] *= 1.0f + spectrumSep;
+    }
+
+    // Dry signal for the Live Mode wet/dry mix
+    const float wet = p.mix / 100.0f;
+    const bool dryMix = liveMode && inputL && inputR;
+
+    // Process each engine frame (hostFrame: the first NT frame it covers)
+    PROFILE_MARK(kStageSetup);
+    for (int frame = 0; frame < engineFrames; frame++) {
+        int hostFrame = frame * engineStep;
+
+        // Clock detection (every host frame - edges wait for the next control
+        // update). At half rate an engine frame covers two host frames, and a
+        // one-sample trigger can land on either, so the edge sees their max
+        float clockIn = 0;
+        if (cvClock) {
+            clockIn = cvClock[hostFrame];
+            for (int i = 1; i < engineStep; i++) clockIn = fmaxf(clockIn, cvClock[hostFrame + i]);
+        }
+        if (clockIn > 1.0f && dtc->prevClock <= 1.0f) {
+            // Rising edge
+            dtc->clockPending = true;
+            if (dtc->clockReceived) {
+                // Calculate period from last clock
+                dtc->clockPeriod = 1.0f / dtc->clockPhase;  // Period in seconds
+            }
+            dtc->clockPhase = 0;
+            dtc->clockReceived = true;
+        }
+        dtc->prevClock = clockIn;
+        if (dtc->clockReceived) {
+            dtc->clockPhase += dt;
+        }
+
+        // ====== CONTROL UPDATE ======
+        // Drifters, smoothing and triggering run every controlDivisor frames
+        if (--dtc->controlCountdown <= 0) {
+            dtc->controlCountdown = controlDivisor;
+            bool clockEdge = dtc->clockPending;
+            dtc->clockPending = false;
+
+            // Read CV modulation (sampled at the control rate, check for NULL)
+            float anchorMod = cvAnchor ? cvAnchor[hostFrame] * 0.1f : 0;  // ±5V = ±0.5 (50%)
+            float pitchMod = cvPitch ? cvPitch[hostFrame] * 12.0f : 0;  // 1V/oct
+            float driftMod = cvDrift ? 1.0f + cvDrift[hostFrame] * 0.2f : 1.0f;  // ±5V = ±100%
+            float entropyMod = cvEntropy ? fmaxf(0, cvEntropy[hostFrame] * 0.2f) : 0;  // 0-5V = 0-100%
+            float stormGate = cvStorm ? cvStorm[hostFrame] > 1.0f : false;  // Gate threshold
+
+            // Smooth parameters (read directly from v[])
+            float anchorTarget = p.anchor / 100.0f;
+            float driftSpeed = p.drift / 100.0f;
+            float densityRate = densityToRate((float)p.density);
+            dtc->anchorSmooth += (anchorTarget + anchorMod - dtc->anchorSmooth) * smoothRate;
+            dtc->driftSmooth += (driftSpeed * driftMod - dtc->driftSmooth) * smoothRate;
+            dtc->densitySmooth += (densityRate - dtc->densitySmooth) * smoothRate;
+
+            // Entropy with CV and storm
+            float targetEntropy = p.entropy / 100.0f + entropyMod;
+            if (stormGate) {
+                dtc->stormLevel = 1.0f;  // Instant max
+            } else {
+                dtc->stormLevel *= stormDecay;  // Slow decay (~5-10 seconds)
+            }
+            float effectiveEntropy = fminf(1.0f, targetEntropy + dtc->stormLevel);
+            dtc->entropySmooth += (effectiveEntropy - dtc->entropySmooth) * smoothRate;
+
+            // ====== UPDATE DRIFTERS ======
+            float anchor = fmaxf(0, fminf(1, dtc->anchorSmooth));
+            float gravity = p.gravity / 100.0f;
+            float seek = p.seek / 100.0f;
+            float drift = dtc->driftSmooth;
+            float entropy = dtc->entropySmooth;
+
+            float avgPos = 0;
+
+            for (int d = 0; d < kNumDrifters; d++) {
+                Drifter& drifter = dtc->drifters[d];
+
+                // Calculate gravity force toward/away from anchor
+                float dist = drifter.position - anchor;
+                float gravityAccel = -gravity * dist * 100.0f;  // Toward anchor when positive
+
+                // Calculate repulsion from other drifters (only when close)
+                // Repulsion is reduced by boredom - bored drifters can pass each other
+                float repulsion = 0;
+                const float repulsionThreshold = 0.05f;  // Only repel within 5% of sample
+                for (int other = 0; other < kNumDrifters; other++) {
+                    if (other == d) continue;
+                    float diff = drifter.position - dtc->drifters[other].position;
+                    float absDiff = fabsf(diff);
+                    // Only apply repulsion when within threshold distance
+                    if (absDiff < repulsionThreshold && absDiff > 0.001f) {
+                        // Inversely proportional to distance (stronger when closer)
+                        float strength = 0.00001f / absDiff;
+                        repulsion += (diff > 0 ? 1.0f : -1.0f) * strength;
+                    }
+                }
+                // Scale repulsion by (1 - boredom): bored drifters are attracted to pass
+                repulsion *= (1.0f - drifter.boredom * 1.05f);  // -5% at full boredom
+
+                // Random walk based on entropy
+                float randomWalk = randFloatBipolar(dtc) * entropy * 0.01f;
+
+                // Content seeking: climb (or descend) the local energy gradient
+                // Boredom sharpens the search - restless drifters go looking for action
+                float seekForce = 0;
+                if (features && seek != 0.0f) {
+                    int reach = (numFeatureBins / 50 > 2) ? numFeatureBins / 50 : 2;  // ~2% of the sample
+                    int binLo, binHi;
+                    if (liveMode) {
+                        // Frozen live buffer: position runs backwards in time from the
+                        // write head, and the map wraps with the buffer
+                        int here = livePosition(dtc->writePointer, view.length, liveSafeDistance, drifter.position)
+                                   >> kFeatureBinShift;
+                        binLo = (here + reach) % numFeatureBins;
+                        binHi = (here - reach + numFeatureBins) % numFeatureBins;
+                    } else {
+                        int here = (int)(drifter.position * sampleLen) >> kFeatureBinShift;
+                        binLo = (here - reach < 0) ? 0 : here - reach;
+                        binHi = (here + reach >= numFeatureBins) ? numFeatureBins - 1 : here + reach;
+                    }
+                    float gradient = fromFeatureLevel(features[binHi].rms) - fromFeatureLevel(features[binLo].rms);
+                    seekForce = seek * gradient * (0.5f + drifter.boredom) * 0.0005f;
+                }
+
+                // Update velocity
+                drifter.velocity += gravityAccel * controlDt;
+                drifter.velocity += repulsion * controlFrames;  // Add repulsion force
+                drifter.velocity += randomWalk * walkScale;
+                drifter.velocity += seekForce * controlFrames;
+                drifter.velocity *= velocityDamping;  // Slightly less aggressive damping
+
+                // Base drift speed - uses stored variation and BIDIRECTIONAL direction
+                // Scale by dt so drift is time-based, not sample-rate dependent
+                // 0.05 gives ~1% per second at 30% drift - slow ambient movement
+                float baseDrift = drift * drifter.variation * drifter.driftDirection * controlDt * 0.05f;
+
+                // Update position
+                drifter.position += drifter.velocity * controlDt + baseDrift;
+
+                // Constrain to wander range around anchor
+                float minPos = anchor - wander;
+                float maxPos = anchor + wander;
+
+                // Soft boundaries with bounce - reverse drift direction on hit
+                if (drifter.position < minPos) {
+                    drifter.position = minPos + (minPos - drifter.position) * 0.5f;
+                    drifter.velocity = fabsf(drifter.velocity) * 0.5f;
+                    drifter.driftDirection = 1.0f;  // Now drift right
+                }
+                if (drifter.position > maxPos) {
+                    drifter.position = maxPos - (drifter.position - maxPos) * 0.5f;
+                    drifter.velocity = -fabsf(drifter.velocity) * 0.5f;
+                    drifter.driftDirection = -1.0f;  // Now drift left
+                }
+
+
+                // Hard clamp
+                drifter.position = fmaxf(0.001f, fminf(0.999f, drifter.position));
+
+                // Update boredom: builds up when staying in same region, resets on movement
+                const float boredomMovementThreshold = 0.03f;  // 3% movement resets boredom
+                const float boredomBuildRate = 0.05f;          // Time to full boredom ~20 sec
+                float movementFromHome = fabsf(drifter.position - drifter.lastSignificantPos);
+                if (movementFromHome > boredomMovementThreshold) {
+                    // Moved significantly - reset boredom and update home
+                    drifter.boredom = 0;
+                    drifter.lastSignificantPos = drifter.position;
+                } else {
+                    // Staying in same region - slowly increase boredom
+                    drifter.boredom = fminf(1.0f, drifter.boredom + boredomBuildRate * controlDt);
+                }
+
+                avgPos += drifter.position;
+                PROFILE_MARK(kStagePhysics);
+
+                // ====== GRAIN TRIGGERING ======
+                drifter.timeSinceGrain += controlDt;
+
+                // Determine if we should trigger a grain
+                bool shouldTrigger = false;
+                float deviation = p.deviation / 100.0f;
+
+                if (dtc->clockReceived && deviation < 1.0f) {
+                    // Clock sync mode
+                    if (deviation == 0.0f) {
+                        // Pure clock sync: only trigger on clock edges
+                        // Each drifter triggers on clock (could add phase offsets later)
+                        shouldTrigger = clockEdge;
+                    } else {
+                        // Blended mode: clock edges always trigger, plus some Poisson triggers
+                        // The lower the deviation, the fewer random triggers
+                        if (clockEdge) {
+                            shouldTrigger = true;
+                        } else if (drifter.timeSinceGrain >= drifter.nextGrainTime) {
+                            // Random trigger with probability based on deviation
+                            shouldTrigger = (randFloat(dtc) < deviation);
+                        }
+                    }
+                } else {
+                    // Free-running Poisson mode
+                    shouldTrigger = (drifter.timeSinceGrain >= drifter.nextGrainTime);
+                }
+
+                if (shouldTrigger) {
+                    // Trigger new grain
+                    drifter.timeSinceGrain = 0;
+                    dtc->telemetry.triggers++;
+
+                    // Calculate lambda for NEXT grain interval
+                    float lambda = dtc->densitySmooth;
+
+                    // Add entropy-based jitter to rate
+                    lambda *= 1.0f + randFloatBipolar(dtc) * entropy * 0.5f;
+
+                    drifter.nextGrainTime = randExponential(dtc, lambda);
+
+                    // Find free grain slot
+                    bool allocated = false;
+                    for (int g = 0; g < kMaxTotalGrains; g++) {
+                        if (!dtc->grains[g].active) {
+                            Grain& grain = dtc->grains[g];
+                            grain.active = true;
+                            allocated = true;
+
+                            // Calculate grain start position
+                            int rawPos;
+                            if (liveMode) {
+                                // In Live Mode: position is relative to write head (behind it)
+                                // This keeps drifters always in the safe "past" area of the buffer
+                                rawPos = livePosition(dtc->writePointer, view.length, liveSafeDistance, drifter.position);
+                                // Snap to a zero crossing only once the frozen buffer is indexed
+                                // (a running buffer changes under any search)
+                                grain.position = toGrainPosition(zeroCrossings
+                                    ? lookupZeroCrossing(zeroCrossings, numZeroCrossBlocks, rawPos, 256)
+                                    : rawPos);
+                            } else {
+                                // Sample mode: absolute position with zero-crossing snap
+                                rawPos = (int)(drifter.position * sampleLen);
+                                grain.position = toGrainPosition(zeroCrossings
+                                    ? lookupZeroCrossing(zeroCrossings, numZeroCrossBlocks, rawPos, 256)
+                                    : findNearestZeroCrossing(view, rawPos, 256));
+                            }
+                            grain.phase = 0;
+                            float grainSize = densityToSize((float)p.density) * engineRate;
+                            grain.phaseDelta = (uint32_t)(4294967296.0f / grainSize);
+                            grain.drifterIndex = d;
+                            grain.shape = (GrainShape)p.shape;
+                            grain.amplitude = 1.0f;  // Base amplitude (soft clipping handles overload)
+
+                            int scaleIndex = p.scale;
+
+                            // With a scale: find the source pitch and quantize to stay in scale
+                            // Samples (and frozen live audio) use their pitch map once it is
+                            // built. A running live buffer is measured at the trigger, but
+                            // only once per block - other triggers in the block reuse what
+                            // their drifter heard last, so the cost stays bounded
+                            float detectedPitch = 0.0f;
+                            if (scaleIndex > 0) {
+                                if (pitchMap) {
+                                    detectedPitch = lookupPitch(pitchMap, numPitchBins, rawPos);
+                                } else if (liveMode) {
+                                    if (!livePitchMeasured) {
+                                        drifter.livePitch = detectPitch(view, rawPos, sr, 512);
+                                        livePitchMeasured = true;
+                                    }
+                                    detectedPitch = drifter.livePitch;
+                                }
+                            }
+
+                            float pitchSemis;
+
+                            if (scaleIndex == 0) {
+                                pitchSemis = (float)p.pitch + pitchMod;
+
+                                float scatterDir = (d == 0 || d == 3) ? 1.0f : -1.0f;
+                                float scatterMagnitude = (d == 0 || d == 3) ? fabsf(d - 1.5f) : fabsf(d - 1.5f);
+                                pitchSemis += (float)p.scatter * scatterDir * (scatterMagnitude / 1.5f);
+
+                                pitchSemis += randFloatBipolar(dtc) * entropy * 2.0f;
+                            } else {
+                                float basePitch = (float)p.pitch;
+
+                                // Use the source pitch as reference, quantize to scale
+                                if (detectedPitch != 0.0f) {
+                                    // Quantize detected pitch to scale, use that as base
+                                    basePitch += quantizePitchToScale(detectedPitch, scaleIndex) - detectedPitch;
+                                }
+
+                                if (pitchMod != 0.0f) {
+                                    basePitch += quantizePitchToScale(pitchMod, scaleIndex);
+                                }
+
+                                float scatterDir = (d == 0 || d == 3) ? 1.0f : -1.0f;
+                                float scatterMagnitude = (d == 0 || d == 3) ? fabsf(d - 1.5f) : fabsf(d - 1.5f);
+                                int scatterDegrees = (int)roundf((float)p.scatter * scatterDir * (scatterMagnitude / 1.5f));
+
+                                float scatterSemis = degreeToSemitones(scatterDegrees, scaleIndex);
+                                pitchSemis = basePitch + scatterSemis;
+
+                                // Entropy adds random scale degrees, biased toward characteristic notes
+                                if (entropy > 0.01f) {
+                                    int maxDegrees = (int)(entropy * 4.0f);  // 0-4 degrees based on entropy
+                                    if (maxDegrees > 0) {
+                                        int jitterDegree = getCharacteristicDegree(dtc, scaleIndex, maxDegrees);
+                                        pitchSemis += degreeToSemitones(jitterDegree, scaleIndex);
+                                    }
+                                }
+                            }
+
+                            // Include sample rate ratio for proper playback speed
+                            // Calculate sample rate ratio on the fly (handles NT sample rate changes)
+                            float sampleRateRatio = sourceSampleRate / engineRate;
+                            float playbackRate = powf(2.0f, pitchSemis / 12.0f) * sampleRateRatio;
+                            grain.positionDelta = toGrainRate(playbackRate);
+                            grain.featureBin = -1;
+                            grain.silent = false;
+                            grain.source = currentSource;
+                            grain.proximityStep = 0;
+                            grain.proximityGain = (currentSource == kSourceLive)
+                                ? liveProximityGain(dtc->writePointer, view.length, grainFrame(grain.position),
+                                                    grainRate(grain.positionDelta), engineFrames - frame, liveFadeFrames)
+                                : 1.0f;
+
+                            // Skip grains that would only read silence (frees the slot at once)
+                            if (features) {
+                                int startBin = grainFrame(grain.position) >> kFeatureBinShift;
+                                int spanBins = ((int)(grainSize * playbackRate) >> kFeatureBinShift) + 1;
+                                if (features[startBin].silentRun >= spanBins) {
+                                    grain.active = false;
+                                    dtc->telemetry.silent++;
+                                    break;
+                                }
+                            }
+
+                            // HQ grain filters aren't reset - state carries over to avoid transients
+
+                            // Pulse output trigger
+                            dtc->pulseOut = true;
+                            dtc->telemetry.drifterGrains[d]++;
+
+                            break;
+                        }
+                    }
+                    if (!allocated) dtc->telemetry.dropped++;
+                }
+                PROFILE_MARK(kStageTrigger);
+            }
+
+            dtc->averagePosition = avgPos / kNumDrifters;
+
+            // Stereo panning based on drifter position relative to anchor
+            // Left of anchor = left pan, right of anchor = right pan
+            for (int d = 0; d < kNumDrifters; d++) {
+                float pan = (wander > 0.01f) ? (dtc->drifters[d].position - anchor) / wander : 0;
+                pan = fmaxf(-1.0f, fminf(1.0f, pan));  // Clamp to -1..+1
+                // Linear crossfade panning (cheap, sounds fine for ambient)
+                dtc->drifterPanL[d] = 0.5f - pan * 0.5f;
+                dtc->drifterPanR[d] = 0.5f + pan * 0.5f;
+            }
+        }
+        PROFILE_MARK(kStagePhysics);
+
+        // ====== RENDER GRAINS ======
+        // Grains sum into their drifter's stereo bus
+        float busL[kNumDrifters] = { 0 };
+        float busR[kNumDrifters] = { 0 };
+        int activeGrains = 0;
+
+        for (int g = 0; g < kMaxTotalGrains; g++) {
+            Grain& grain = dtc->grains[g];
+            if (!grain.active) continue;
+            activeGrains++;
+
+            // CPU protection: skip rendering if we've hit the limit
+            if (activeGrains > tier.maxActiveGrains) {
+                dtc->telemetry.skippedFrames++;
+                continue;
+            }
+
+            // Grains read from the source they were born in
+            const GrainSource& source = sources[grain.source];
+            int length = source.view.length;
+            if (length < 100) {
+                grain.active = false;
+                continue;
+            }
+            uint64_t sourceLen = toGrainPosition(length);
+            if (grain.position >= sourceLen) {
+                grain.position %= sourceLen;  // Source swapped for a shorter one under the grain
+            }
+
+            int pos0 = grainFrame(grain.position);
+            float frac = grainFraction(grain.position);
+
+            // Silent stretch of the sample: just move the grain along
+            if (source.features) {
+                int bin = pos0 >> kFeatureBinShift;
+                if (bin != grain.featureBin) {
+                    grain.featureBin = bin;
+                    grain.silent = source.features[bin].silentRun > 0;
+                }
+                if (grain.silent) {
+                    advanceGrain(grain, sourceLen);
+                    continue;
+                }
+            }
+
+            // In Live Mode, fade out grains approaching the write head
+            // (gain checked once per block - see above)
+            float liveProximityFade = 1.0f;
+            if (grain.source == kSourceLive) {
+                if (grain.proximityGain <= 0.0f && grain.proximityStep <= 0.0f) {
+                    // Reached the write head - release the slot
+                    grain.active = false;
+                    continue;
+                }
+                liveProximityFade = fmaxf(0.0f, grain.proximityGain);
+                grain.proximityGain += grain.proximityStep;
+            }
+
+            // Read sample - stereo in Live Mode, mono for sample playback
+            const SampleView& grainView = source.view;
+            float sampleL, sampleR;
+            if (grainView.right) {
+                // True stereo reading from both buffers
+                sampleL = interpolate(grainView, grainView.left, pos0, frac, tier.interpolation, dram->interpKernel);
+                sampleR = interpolate(grainView, grainView.right, pos0, frac, tier.interpolation, dram->interpKernel);
+            } else {
+                sampleL = interpolate(grainView, NULL, pos0, frac, tier.interpolation, dram->interpKernel);
+                sampleR = sampleL;
+            }
+
+            // Apply grain envelope (with proximity fade in Live Mode)
+            // and the mode crossfade gain for the grain's source
+            float modeGain = (grain.source == kSourceLive) ? dtc->liveModeGain : dtc->sampleModeGain;
+            float env = lookupEnvelope(dram->envelopes[quality][grain.shape], tier.envelopeBits,
+                                       tier.envelopeLerp, grain.phase) * liveProximityFade * modeGain;
+            sampleL *= env * grain.amplitude;
+            sampleR *= env * grain.amplitude;
+
+            // HQ: each grain through its own band filter, so overlapping
+            // grains don't share filter state
+            if (grainFilter) {
+                int d = grain.drifterIndex;
+                sampleL = grain.filterL.process(sampleL, filterCoeff[d], filterQ);
+                sampleR = grain.filterR.process(sampleR, filterCoeff[d], filterQ);
+            }
+
+            busL[grain.drifterIndex] += sampleL;
+            busR[grain.drifterIndex] += sampleR;
+
+            advanceGrain(grain, sourceLen);
+        }
+        dtc->telemetry.activeFrames += activeGrains;
+        if ((uint32_t)activeGrains > dtc->telemetry.peakActive) dtc->telemetry.peakActive = activeGrains;
+        dtc->telemetry.engineFrames++;
+        PROFILE_MARK(kStageGrains);
+
+        // ====== DRIFTER BUSES ======
+        // Spectrum filter (unless the grains had their own), tilt and pan
+        // run once per drifter, however many grains it has sounding
+        float mixL = 0;
+        float mixR = 0;
+
+        for (int d = 0; d < kNumDrifters; d++) {
+            float sampleL = busL[d];
+            float sampleR = busR[d];
+
+            // Apply filter bank separation (spectrum parameter)
+            if (busFilter) {
+                sampleL = dtc->drifterFilterL[d].process(sampleL, filterCoeff[d], filterQ);
+                sampleR = dtc->drifterFilterR[d].process(sampleR, filterCoeff[d], filterQ);
+            }
+
+            // Apply tilt and filter makeup gain
+            sampleL *= busGain[d];
+            sampleR *= busGain[d];
+
+            float panL = dtc->drifterPanL[d];
+            float panR = dtc->drifterPanR[d];
+            mixL += sampleL * panL + sampleR * (1.0f - panL);
+            mixR += sampleL * (1.0f - panR) + sampleR * panR;
+        }
+
+        // Normalize by grain count to prevent saturation (sqrt for density perception)
+        // Smooth the normalization factor to prevent clicks from sudden grain count changes
+        float targetNorm = (activeGrains > 1) ? 1.0f / sqrtf((float)activeGrains) : 1.0f;
+        dtc->smoothNorm += normRate * (targetNorm - dtc->smoothNorm);  // Very slow smoothing
+        if (dtc->smoothNorm < 0.1f) dtc->smoothNorm = 0.1f;  // Prevent divide issues
+        mixL *= dtc->smoothNorm;
+        mixR *= dtc->smoothNorm;
+        PROFILE_MARK(kStageBuses);
+
+        if (engineStep > 1) {
+            // Half rate: upsampled and finished below
+            wetL[frame] = mixL;
+            wetR[frame] = mixR;
+        } else {
+            // In Live Mode: apply wet/dry mix (100% = full wet/grains, 0% = full dry/input)
+            mixL = finishOutput(mixL, dryMix ? inputL : NULL, frame, wet, tier.exactClipper);
+            mixR = finishOutput(mixR, dryMix ? inputR : NULL, frame, wet, tier.exactClipper);
+
+            // Output audio
+            if (replaceL) outL[frame] = mixL;
+            else outL[frame] += mixL;
+            if (replaceR) outR[frame] = mixR;
+            else outR[frame] += mixR;
+        }
+
+        // CV outputs (always replace - add mode would accumulate values each frame)
+        for (int i = hostFrame; i < hostFrame + engineStep; i++) {
+            if (cvOutPos) cvOutPos[i] = dtc->averagePosition * 5.0f;  // 0-5V
+            if (cvOutPulse) cvOutPulse[i] = dtc->pulseOut ? 5.0f : 0;
+        }
+        dtc->pulseOut = false;
+        PROFILE_MARK(kStageOutput);
+    }
+
+    // Half rate: upsample to the NT rate, then mix, clip and output as above
+    if (engineStep > 1) {
+        for (int frame = 0; frame < engineFrames; frame++) {
+            float pairL[2], pairR[2];
+            upsamplePair(wetL + frame, dtc->halfBand, pairL[0], pairL[1]);
+            upsamplePair(wetR + frame, dtc->halfBand, pairR[0], pairR[1]);
+
+            for (int i = 0; i < 2; i++) {
+                int hostFrame = frame * 2 + i;
+                float mixL = finishOutput(pairL[i], dryMix ? inputL : NULL, hostFrame, wet, tier.exactClipper);
+                float mixR = finishOutput(pairR[i], dryMix ? inputR : NULL, hostFrame, wet, tier.exactClipper);
+                if (replaceL) outL[hostFrame] = mixL;
+                else outL[hostFrame] += mixL;
+                if (replaceR) outR[hostFrame] = mixR;
+                else outR[hostFrame] += mixR;
+            }
+        }
+
+        // Keep the newest engine frames as history for the next block
+        memcpy(dtc->upsampleHistoryL, wetL + engineFrames - kHalfBandTaps, sizeof(dtc->upsampleHistoryL));
+        memcpy(dtc->upsampleHistoryR, wetR + engineFrames - kHalfBandTaps, sizeof(dtc->upsampleHistoryR));
+        PROFILE_MARK(kStageOutput);
+    }
+    telemetryEndBlock(dtc->telemetry, dtc->shownTelemetry, numFrames, cvOutTelemetry, telemetryMode, sr);
+#ifdef DRIFTERS_PROFILE
+    profileEndBlock(dtc->profile, numFrames, sr);
+#endif
+}
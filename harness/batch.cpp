@@ -0,0 +1,593 @@
+/*
+ * Drifters - parallel batch renderer
+ *
+ * Renders every combination of presets, samples and seeds to WAV, spread
+ * over all CPU cores, for stems and auditioning:
+ *
+ *   drifters_batch --samples ~/samples --all-samples --seeds 1-4 \
+ *       --preset "mist Density=30 Shape=0" --preset "hail Density=90 Shape=3" -o renders/
+ *
+ * One worker thread per core takes jobs from a work-stealing queue: each
+ * worker starts with its share of the jobs and, once through them, takes
+ * from the far end of the busiest queue. The engine core
+ * (drifters_engine.h) keeps no globals, but batch renders through the whole
+ * plugin so a render matches drifters_host bit for bit, and the adapter is
+ * still process-wide: every instance is handed the one NT_globals.workBuffer
+ * as scratch, and the stub's card-read queue and parameter tables are
+ * file-static, as on the module. So each job renders in a forked child with
+ * its own SRAM/DTC/DRAM allocation; samples are read once, before the
+ * workers start, and shared with every child.
+ */
+
+#include "nt_stub.h"
+
+#include <distingnt/wav.h>
+
+#include <math.h>
+#include <cmath>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+// ============================================================================
+// JOBS
+// ============================================================================
+
+static constexpr double kDrawRate = 30.0;
+
+struct Preset {
+    std::string name;
+    std::vector<std::string> params;    // NAME=VALUE
+};
+
+struct BatchJob {
+    const Preset* preset;
+    int folder;
+    int sample;
+    int32_t seed;
+    std::string label;         // PRESET-FOLDER-SAMPLE-seedN
+    std::string outputPath;    // Empty: render without writing
+};
+
+// What a child sends back through its pipe
+struct JobStats {
+    int ok;
+    int nonFinite;
+    double stepSeconds;
+    double rms;
+    float peak;
+};
+
+struct BatchOptions {
+    const char* samplesPath;
+    const char* outputDir;
+    const char* inputPath;
+    double seconds;
+    int blockSize;
+    int workers;
+    bool allSamples;
+    bool quiet;
+    std::vector<std::pair<int, int>> samples;    // Folder, sample
+    std::vector<int32_t> seeds;
+    std::vector<Preset> presets;
+    std::vector<std::string> specs;              // NAME=VALUE
+    std::vector<std::string> params;             // NAME=VALUE, under every preset
+};
+
+static void usage() {
+    printf("Usage: drifters_batch --samples DIR [options] [NAME=VALUE ...]\n"
+           "\n"
+           "  NAME=VALUE           Set a parameter in every render (presets override)\n"
+           "  --samples DIR        Sample folders (subdirectories of WAV files)\n"
+           "  --sample F:S         Render folder F, sample S (repeatable; default 0:0)\n"
+           "  --all-samples        Render every sample in every folder\n"
+           "  --preset \"NAME A=1 B=2\"  A named set of parameter values (repeatable)\n"
+           "  --presets FILE       Presets, one per line in the same form ('#' comments)\n"
+           "  --seeds LIST         Seeds to render, e.g. 1-8 or 1,5,9 (default 0)\n"
+           "  --spec NAME=VALUE    Set a specification in every render\n"
+           "  --input FILE         WAV looped into the Input L/R busses (Live Mode)\n"
+           "  -o DIR               Write each render to DIR as a 32-bit float WAV\n"
+           "  -t SECONDS           Length of each render (default 10)\n"
+           "  -b FRAMES            Block size, a multiple of 4 (default 32)\n"
+           "  -j WORKERS           Parallel renders (default: one per core)\n"
+           "  -q                   Only print the summary\n"
+           "\n"
+           "Renders are named PRESET-FOLDER-SAMPLE-seedN.wav.\n");
+}
+
+// "NAME A=1 B=2" -> a preset
+static bool parsePreset(const std::string& text, Preset& preset) {
+    std::vector<std::string> words;
+    size_t start = text.find_first_not_of(" \t\r\n");
+    while (start != std::string::npos) {
+        size_t end = text.find_first_of(" \t\r\n", start);
+        words.push_back(text.substr(start, end == std::string::npos ? std::string::npos : end - start));
+        start = (end == std::string::npos) ? end : text.find_first_not_of(" \t\r\n", end);
+    }
+    if (words.empty() || words[0].find('=') != std::string::npos) return false;
+    preset.name = words[0];
+    preset.params.assign(words.begin() + 1, words.end());
+    for (size_t i = 0; i < preset.params.size(); i++) {
+        if (preset.params[i].find('=') == std::string::npos) return false;
+    }
+    return true;
+}
+
+static bool readPresets(const char* path, std::vector<Preset>& presets) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "drifters_batch: can't read %s\n", path);
+        return false;
+    }
+    char line[1024];
+    int lineNumber = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), f)) {
+        lineNumber++;
+        std::string text = line;
+        if (text.find_first_not_of(" \t\r\n") == std::string::npos || text[text.find_first_not_of(" \t")] == '#') continue;
+        Preset preset;
+        ok = parsePreset(text, preset);
+        if (ok) presets.push_back(preset);
+        else fprintf(stderr, "drifters_batch: %s:%d: expected NAME A=1 B=2 ...\n", path, lineNumber);
+    }
+    fclose(f);
+    return ok;
+}
+
+// "1-4,9" -> 1 2 3 4 9
+static bool parseSeeds(const char* text, std::vector<int32_t>& seeds) {
+    std::string s = text;
+    size_t start = 0;
+    while (start < s.size()) {
+        size_t end = s.find(',', start);
+        if (end == std::string::npos) end = s.size();
+        std::string range = s.substr(start, end - start);
+        int first, last;
+        if (sscanf(range.c_str(), "%d-%d", &first, &last) == 2) {
+        } else if (sscanf(range.c_str(), "%d", &first) == 1) {
+            last = first;
+        } else {
+            return false;
+        }
+        if (first < 0 || last < first || last > 32767) return false;
+        for (int seed = first; seed <= last; seed++) seeds.push_back(seed);
+        start = end + 1;
+    }
+    return !seeds.empty();
+}
+
+static bool parseOptions(int argc, char** argv, BatchOptions& opt) {
+    opt.samplesPath = NULL;
+    opt.outputDir = NULL;
+    opt.inputPath = NULL;
+    opt.seconds = 10.0;
+    opt.blockSize = 32;
+    opt.workers = (int)std::thread::hardware_concurrency();
+    opt.allSamples = false;
+    opt.quiet = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (arg == "-h" || arg == "--help") {
+            usage();
+            exit(0);
+        } else if (arg == "-q") {
+            opt.quiet = true;
+        } else if (arg == "--all-samples") {
+            opt.allSamples = true;
+        } else if (arg == "--samples" && hasValue) {
+            opt.samplesPath = argv[++i];
+        } else if (arg == "--sample" && hasValue) {
+            int folder, sample;
+            if (sscanf(argv[++i], "%d:%d", &folder, &sample) != 2) {
+                fprintf(stderr, "drifters_batch: --sample wants FOLDER:SAMPLE, got '%s'\n", argv[i]);
+                return false;
+            }
+            opt.samples.push_back(std::make_pair(folder, sample));
+        } else if (arg == "--preset" && hasValue) {
+            Preset preset;
+            if (!parsePreset(argv[++i], preset)) {
+                fprintf(stderr, "drifters_batch: --preset wants \"NAME A=1 B=2 ...\", got '%s'\n", argv[i]);
+                return false;
+            }
+            opt.presets.push_back(preset);
+        } else if (arg == "--presets" && hasValue) {
+            if (!readPresets(argv[++i], opt.presets)) return false;
+        } else if (arg == "--seeds" && hasValue) {
+            if (!parseSeeds(argv[++i], opt.seeds)) {
+                fprintf(stderr, "drifters_batch: --seeds wants a list like 1-8,12, got '%s'\n", argv[i]);
+                return false;
+            }
+        } else if (arg == "--spec" && hasValue) {
+            opt.specs.push_back(argv[++i]);
+        } else if (arg == "--input" && hasValue) {
+            opt.inputPath = argv[++i];
+        } else if (arg == "-o" && hasValue) {
+            opt.outputDir = argv[++i];
+        } else if (arg == "-t" && hasValue) {
+            opt.seconds = atof(argv[++i]);
+        } else if (arg == "-b" && hasValue) {
+            opt.blockSize = atoi(argv[++i]);
+        } else if (arg == "-j" && hasValue) {
+            opt.workers = atoi(argv[++i]);
+        } else if (arg.find('=') != std::string::npos && arg[0] != '-') {
+            opt.params.push_back(arg);
+        } else {
+            fprintf(stderr, "drifters_batch: unknown option '%s'\n", argv[i]);
+            return false;
+        }
+    }
+
+    if (opt.blockSize < 4 || opt.blockSize % 4 || opt.blockSize > (int)NT_globals.maxFramesPerStep) {
+        fprintf(stderr, "drifters_batch: block size must be a multiple of 4 up to %u\n", NT_globals.maxFramesPerStep);
+        return false;
+    }
+    if (opt.workers < 1) opt.workers = 1;
+    if (opt.seeds.empty()) opt.seeds.push_back(0);
+    if (opt.presets.empty()) {
+        Preset preset;
+        preset.name = "default";
+        opt.presets.push_back(preset);
+    }
+    return true;
+}
+
+// Letters, digits, '-' and '.' kept; anything else becomes '_'
+static std::string fileNamePart(const std::string& text) {
+    std::string s = text;
+    for (size_t i = 0; i < s.size(); i++) {
+        char c = s[i];
+        if (!isalnum((unsigned char)c) && c != '-' && c != '.') s[i] = '_';
+    }
+    return s;
+}
+
+// ============================================================================
+// RENDERING (in the child)
+// ============================================================================
+
+static bool applyAssignments(NtStubInstance& instance, const std::vector<std::string>& assignments) {
+    for (size_t i = 0; i < assignments.size(); i++) {
+        size_t eq = assignments[i].rfind('=');
+        int index = ntStubFindParameter(instance, assignments[i].substr(0, eq).c_str());
+        if (index < 0) {
+            fprintf(stderr, "drifters_batch: unknown parameter in '%s'\n", assignments[i].c_str());
+            return false;
+        }
+        const _NT_parameter& p = instance.algorithm->parameters[index];
+        int value = atoi(assignments[i].c_str() + eq + 1);
+        instance.values[index] = (int16_t)std::max((int)p.min, std::min((int)p.max, value));
+    }
+    return true;
+}
+
+static double nowSeconds() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static JobStats render(const BatchOptions& opt, const BatchJob& job, const std::vector<int32_t>& baseSpecs,
+                       const std::vector<float>& input, uint32_t inputChannels) {
+    JobStats stats;
+    memset(&stats, 0, sizeof(stats));
+
+    std::vector<int32_t> specs = baseSpecs;
+    specs[ntStubFindSpecification("Seed")] = job.seed;
+    NtStubInstance instance;
+    if (!ntStubCreate(instance, specs.data())) {
+        fprintf(stderr, "drifters_batch: out of memory\n");
+        return stats;
+    }
+
+    std::vector<std::string> assignments = opt.params;
+    assignments.insert(assignments.end(), job.preset->params.begin(), job.preset->params.end());
+    assignments.push_back("Folder=" + std::to_string(job.folder));
+    assignments.push_back("Sample=" + std::to_string(job.sample));
+    if (!applyAssignments(instance, assignments)) {
+        ntStubDestroy(instance);
+        return stats;
+    }
+    ntStubAnnounceParameters(instance);
+
+    const int blockSize = opt.blockSize;
+    const uint32_t sampleRate = NT_globals.sampleRate;
+    const uint64_t totalFrames = (uint64_t)(opt.seconds * sampleRate);
+    const uint64_t drawInterval = (uint64_t)(sampleRate / kDrawRate);
+    const uint64_t inputFrames = input.size() / std::max(1u, inputChannels);
+    std::vector<float> busses(kStubNumBusses * blockSize);
+    std::vector<float> output;
+    if (!job.outputPath.empty()) output.reserve(totalFrames * 2);
+    double sumSquares = 0;
+    uint64_t nextDraw = 0;
+
+    for (uint64_t frame = 0; frame < totalFrames; frame += blockSize) {
+        ntStubPumpLoads();
+
+        std::fill(busses.begin(), busses.end(), 0.0f);
+        if (inputFrames) {
+            int busL = ntStubAudioBus(instance, kNT_unitAudioInput, 0);
+            int busR = ntStubAudioBus(instance, kNT_unitAudioInput, 1);
+            for (int i = 0; i < blockSize; i++) {
+                const float* in = &input[((frame + i) % inputFrames) * inputChannels];
+                if (busL >= 0) busses[busL * blockSize + i] = in[0];
+                if (busR >= 0) busses[busR * blockSize + i] = in[inputChannels > 1 ? 1 : 0];
+            }
+        }
+
+        double start = nowSeconds();
+        instance.factory->step(instance.algorithm, busses.data(), blockSize / 4);
+        stats.stepSeconds += nowSeconds() - start;
+
+        if (frame >= nextDraw && instance.factory->draw) {
+            instance.factory->draw(instance.algorithm);
+            nextDraw += drawInterval;
+        }
+
+        int outL = ntStubAudioBus(instance, kNT_unitAudioOutput, 0);
+        int outR = ntStubAudioBus(instance, kNT_unitAudioOutput, 1);
+        for (int i = 0; i < blockSize && frame + i < totalFrames; i++) {
+            float l = (outL >= 0) ? busses[outL * blockSize + i] : 0;
+            float r = (outR >= 0) ? busses[outR * blockSize + i] : 0;
+            if (!std::isfinite(l) || !std::isfinite(r)) stats.nonFinite = 1;
+            sumSquares += 0.5 * ((double)l * l + (double)r * r);
+            stats.peak = std::max(stats.peak, std::max(fabsf(l), fabsf(r)));
+            if (!job.outputPath.empty()) {
+                output.push_back(l);
+                output.push_back(r);
+            }
+        }
+    }
+    ntStubDestroy(instance);
+
+    stats.rms = totalFrames ? sqrt(sumSquares / totalFrames) : 0.0;
+    stats.ok = 1;
+    if (!job.outputPath.empty() &&
+        !ntStubWriteWav(job.outputPath.c_str(), output.data(), (uint32_t)(output.size() / 2), 2, sampleRate)) {
+        fprintf(stderr, "drifters_batch: can't write %s\n", job.outputPath.c_str());
+        stats.ok = 0;
+    }
+    return stats;
+}
+
+// Render one job in a child process and collect its stats - the child gets
+// its own copy of the adapter's and stub's globals
+static JobStats renderInChild(const BatchOptions& opt, const BatchJob& job, const std::vector<int32_t>& specs,
+                              const std::vector<float>& input, uint32_t inputChannels) {
+    JobStats stats;
+    memset(&stats, 0, sizeof(stats));
+    int fds[2];
+    if (pipe(fds) != 0) return stats;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        JobStats result = render(opt, job, specs, input, inputChannels);
+        ssize_t written = write(fds[1], &result, sizeof(result));
+        _exit(written == (ssize_t)sizeof(result) ? 0 : 1);
+    }
+    close(fds[1]);
+    if (pid > 0) {
+        if (read(fds[0], &stats, sizeof(stats)) != (ssize_t)sizeof(stats)) memset(&stats, 0, sizeof(stats));
+        int status;
+        waitpid(pid, &status, 0);
+    }
+    close(fds[0]);
+    return stats;
+}
+
+// ============================================================================
+// WORK-STEALING QUEUE
+// ============================================================================
+
+// Each worker pops from the back of its own deque and, when that is empty,
+// steals from the front of another's - long sweeps stay balanced however
+// unevenly the renders cost
+class WorkQueues {
+public:
+    explicit WorkQueues(int workers) : queues_(workers), locks_(workers) {}
+
+    void push(int worker, int job) {
+        std::lock_guard<std::mutex> lock(locks_[worker]);
+        queues_[worker].push_back(job);
+    }
+
+    // Next job for `worker`, or -1 when every queue is empty
+    int take(int worker, bool& stolen) {
+        stolen = false;
+        {
+            std::lock_guard<std::mutex> lock(locks_[worker]);
+            if (!queues_[worker].empty()) {
+                int job = queues_[worker].back();
+                queues_[worker].pop_back();
+                return job;
+            }
+        }
+        // Steal from whichever queue has the most left
+        for (;;) {
+            int victim = -1;
+            size_t most = 0;
+            for (size_t q = 0; q < queues_.size(); q++) {
+                std::lock_guard<std::mutex> lock(locks_[q]);
+                if (queues_[q].size() > most) {
+                    most = queues_[q].size();
+                    victim = (int)q;
+                }
+            }
+            if (victim < 0) return -1;
+            std::lock_guard<std::mutex> lock(locks_[victim]);
+            if (queues_[victim].empty()) continue;    // Emptied meanwhile - look again
+            int job = queues_[victim].front();
+            queues_[victim].pop_front();
+            stolen = true;
+            return job;
+        }
+    }
+
+private:
+    std::vector<std::deque<int>> queues_;
+    std::vector<std::mutex> locks_;
+};
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+int main(int argc, char** argv) {
+    BatchOptions opt;
+    if (!parseOptions(argc, argv, opt)) return 1;
+
+    if (!ntStubFactory()) {
+        fprintf(stderr, "drifters_batch: plugin has no factory\n");
+        return 1;
+    }
+    if (!opt.samplesPath || ntStubSetSampleRoot(opt.samplesPath) == 0) {
+        fprintf(stderr, "drifters_batch: no WAV files under %s\n", opt.samplesPath ? opt.samplesPath : "(--samples)");
+        return 1;
+    }
+
+    std::vector<int32_t> specs = ntStubDefaultSpecifications();
+    for (size_t i = 0; i < opt.specs.size(); i++) {
+        size_t eq = opt.specs[i].rfind('=');
+        int index = ntStubFindSpecification(opt.specs[i].substr(0, eq).c_str());
+        if (index < 0) {
+            fprintf(stderr, "drifters_batch: unknown specification in '%s'\n", opt.specs[i].c_str());
+            return 1;
+        }
+        specs[index] = atoi(opt.specs[i].c_str() + eq + 1);
+    }
+
+    // Check every name once here rather than in every child
+    {
+        NtStubInstance instance;
+        if (!ntStubCreate(instance, specs.data())) {
+            fprintf(stderr, "drifters_batch: out of memory\n");
+            return 1;
+        }
+        bool ok = applyAssignments(instance, opt.params);
+        for (size_t p = 0; ok && p < opt.presets.size(); p++) ok = applyAssignments(instance, opt.presets[p].params);
+        ntStubDestroy(instance);
+        if (!ok) return 1;
+    }
+
+    // Read every sample the sweep uses now, so the children share them
+    if (opt.allSamples) {
+        opt.samples.clear();
+        for (uint32_t f = 0; f < NT_getNumSampleFolders(); f++) {
+            _NT_wavFolderInfo folderInfo;
+            NT_getSampleFolderInfo(f, folderInfo);
+            for (uint32_t s = 0; s < folderInfo.numSampleFiles; s++) opt.samples.push_back(std::make_pair((int)f, (int)s));
+        }
+    }
+    if (opt.samples.empty()) opt.samples.push_back(std::make_pair(0, 0));
+    std::vector<std::string> sampleNames;
+    for (size_t i = 0; i < opt.samples.size(); i++) {
+        _NT_wavFolderInfo folderInfo;
+        _NT_wavInfo info;
+        NT_getSampleFolderInfo(opt.samples[i].first, folderInfo);
+        NT_getSampleFileInfo(opt.samples[i].first, opt.samples[i].second, info);
+        if (info.numFrames == 0) {
+            fprintf(stderr, "drifters_batch: no sample %d:%d\n", opt.samples[i].first, opt.samples[i].second);
+            return 1;
+        }
+        std::string name = info.name;
+        name = name.substr(0, name.rfind('.'));    // Without ".wav"
+        sampleNames.push_back(fileNamePart(folderInfo.name) + "-" + fileNamePart(name));
+    }
+
+    std::vector<float> input;
+    uint32_t inputChannels = 1;
+    if (opt.inputPath) {
+        uint32_t frames, rate;
+        float* data = ntStubLoadWav(opt.inputPath, frames, inputChannels, rate);
+        if (!data || frames == 0) {
+            fprintf(stderr, "drifters_batch: can't read %s\n", opt.inputPath);
+            return 1;
+        }
+        input.assign(data, data + (size_t)frames * inputChannels);
+        delete[] data;
+    }
+
+    // Presets x samples x seeds
+    std::vector<BatchJob> jobs;
+    for (size_t p = 0; p < opt.presets.size(); p++) {
+        for (size_t s = 0; s < opt.samples.size(); s++) {
+            for (size_t seed = 0; seed < opt.seeds.size(); seed++) {
+                BatchJob job;
+                job.preset = &opt.presets[p];
+                job.folder = opt.samples[s].first;
+                job.sample = opt.samples[s].second;
+                job.seed = opt.seeds[seed];
+                job.label = fileNamePart(opt.presets[p].name) + "-" + sampleNames[s] + "-seed" + std::to_string(job.seed);
+                if (opt.outputDir) job.outputPath = std::string(opt.outputDir) + "/" + job.label + ".wav";
+                jobs.push_back(job);
+            }
+        }
+    }
+
+    const int workers = std::min(opt.workers, (int)jobs.size());
+    WorkQueues queues(workers);
+    for (size_t j = 0; j < jobs.size(); j++) queues.push((int)(j % workers), (int)j);
+
+    std::vector<JobStats> results(jobs.size());
+    std::atomic<int> done(0);
+    std::atomic<int> steals(0);
+    std::mutex printLock;
+    fflush(stdout);    // Nothing buffered may be copied into the children
+
+    double start = nowSeconds();
+    std::vector<std::thread> threads;
+    for (int w = 0; w < workers; w++) {
+        threads.push_back(std::thread([&, w]() {
+            bool stolen;
+            for (int j; (j = queues.take(w, stolen)) >= 0;) {
+                if (stolen) steals++;
+                results[j] = renderInChild(opt, jobs[j], specs, input, inputChannels);
+                int n = ++done;
+                if (!opt.quiet) {
+                    const JobStats& r = results[j];
+                    std::lock_guard<std::mutex> lock(printLock);
+                    printf("[%3d/%zu] %-40s %s rms %.4f peak %.4f step() %.1fx realtime\n", n, jobs.size(),
+                           jobs[j].label.c_str(), r.ok ? (r.nonFinite ? "NON-FINITE" : "ok") : "FAILED", r.rms, r.peak,
+                           r.stepSeconds > 0 ? opt.seconds / r.stepSeconds : 0.0);
+                    fflush(stdout);
+                }
+            }
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); t++) threads[t].join();
+    double wall = nowSeconds() - start;
+
+    int failed = 0, nonFinite = 0;
+    double stepSeconds = 0;
+    for (size_t j = 0; j < results.size(); j++) {
+        if (!results[j].ok) failed++;
+        if (results[j].nonFinite) nonFinite++;
+        stepSeconds += results[j].stepSeconds;
+    }
+    double audio = opt.seconds * jobs.size();
+    printf("%zu renders, %.1fs of audio in %.2fs on %d workers (%d stolen): %.1fx realtime (%.1fx per worker, "
+           "step() alone %.1fx)\n", jobs.size(), audio, wall, workers, steals.load(), audio / wall,
+           audio / wall / workers, stepSeconds > 0 ? audio / stepSeconds : 0.0);
+    if (failed) {
+        fprintf(stderr, "drifters_batch: %d renders failed\n", failed);
+        return 1;
+    }
+    if (nonFinite) {
+        fprintf(stderr, "drifters_batch: %d renders went NaN or infinite\n", nonFinite);
+        return 2;
+    }
+    return 0;
+}
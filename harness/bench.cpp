@@ -0,0 +1,398 @@
+/*
+ * Drifters - microbenchmarks
+ *
+ * Times step() over a fixed set of scenarios (density, spectral processing,
+ * scale quantisation, sample vs live source, quality tier, block size) on
+ * synthetic material, so results don't depend on what's on the disk.
+ *
+ *   drifters_bench -o bench.json --baseline harness/bench_baseline.json
+ *
+ * Each scenario gets a fresh instance, a warm-up long enough for the sample
+ * to load and its background analysis to finish, then several timed runs;
+ * the fastest run is reported. Only step() is timed - draw() still runs at
+ * the display rate so the background jobs behave as on the module.
+ */
+
+#include "nt_stub.h"
+#include "material.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+// ============================================================================
+// SCENARIOS
+// ============================================================================
+
+static constexpr uint32_t kBenchSampleRate = 48000;
+static constexpr double kWarmupSeconds = 1.0;
+static constexpr double kDrawRate = 30.0;
+
+enum BenchSource {
+    kSourceSample,
+    kSourceLiveMono,
+    kSourceLiveStereo,
+};
+
+static const char* const sourceNames[] = { "sample", "live-mono", "live-stereo" };
+
+struct Scenario {
+    std::string name;
+    BenchSource source;
+    int blockSize;
+    std::vector<std::string> params;    // NAME=VALUE
+};
+
+struct Result {
+    std::string name;
+    std::string params;
+    double nsPerFrame;
+    double framesPerSecond;
+    double maxBlockNs;
+};
+
+static std::string join(const std::vector<std::string>& parts, const char* separator) {
+    std::string s;
+    for (size_t i = 0; i < parts.size(); i++) {
+        if (i) s += separator;
+        s += parts[i];
+    }
+    return s;
+}
+
+static Scenario makeScenario(const std::string& group, BenchSource source, int blockSize,
+                             const std::vector<std::string>& params) {
+    Scenario s;
+    s.source = source;
+    s.blockSize = blockSize;
+    s.params = params;
+    s.name = group + "/" + sourceNames[source] + "/" + join(params, ",");
+    if (group == "block") s.name += ",block=" + std::to_string(blockSize);
+    return s;
+}
+
+static std::vector<Scenario> buildScenarios() {
+    std::vector<Scenario> scenarios;
+
+    // Cost against the main controls, at the default quality
+    static const int densities[] = { 0, 25, 50, 75, 100 };
+    for (int source = kSourceSample; source <= kSourceLiveStereo; source++) {
+        for (int spectrum = 0; spectrum <= 60; spectrum += 60) {
+            for (int scale = 0; scale <= 1; scale++) {
+                for (size_t d = 0; d < sizeof(densities) / sizeof(densities[0]); d++) {
+                    std::vector<std::string> params;
+                    params.push_back("Density=" + std::to_string(densities[d]));
+                    params.push_back("Spectrum=" + std::to_string(spectrum));
+                    params.push_back("Scale=" + std::to_string(scale));
+                    scenarios.push_back(makeScenario("matrix", (BenchSource)source, 32, params));
+                }
+            }
+        }
+    }
+
+    // Quality tiers under a heavy patch
+    for (int quality = 0; quality <= 2; quality++) {
+        for (int source = kSourceSample; source <= kSourceLiveStereo; source += 2) {
+            std::vector<std::string> params;
+            params.push_back("Quality=" + std::to_string(quality));
+            params.push_back("Density=75");
+            params.push_back("Spectrum=60");
+            scenarios.push_back(makeScenario("quality", (BenchSource)source, 32, params));
+        }
+    }
+
+    // Per-block overhead
+    static const int blockSizes[] = { 16, 32, 64, 128 };
+    for (size_t b = 0; b < sizeof(blockSizes) / sizeof(blockSizes[0]); b++) {
+        std::vector<std::string> params;
+        params.push_back("Density=75");
+        scenarios.push_back(makeScenario("block", kSourceSample, blockSizes[b], params));
+    }
+    return scenarios;
+}
+
+// ============================================================================
+// RUNNING
+// ============================================================================
+
+static double nowSeconds() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+struct Runner {
+    const _NT_factory* factory;
+    NtStubInstance* instance;
+    const Scenario* scenario;
+    const std::vector<float>* input;    // Looping stereo input
+    std::vector<float> busses;
+    uint64_t inputPos;
+    uint64_t framesSinceDraw;
+};
+
+// Render `frames` frames; returns the time spent in step() and the slowest block
+static double run(Runner& r, uint64_t frames, double& maxBlock) {
+    const int blockSize = r.scenario->blockSize;
+    const uint64_t inputFrames = r.input->size() / 2;
+    const uint64_t drawInterval = (uint64_t)(kBenchSampleRate / kDrawRate);
+    int busL = ntStubAudioBus(*r.instance, kNT_unitAudioInput, 0);
+    int busR = ntStubAudioBus(*r.instance, kNT_unitAudioInput, 1);
+    double total = 0;
+    maxBlock = 0;
+
+    for (uint64_t frame = 0; frame < frames; frame += blockSize) {
+        ntStubPumpLoads();
+
+        std::fill(r.busses.begin(), r.busses.end(), 0.0f);
+        for (int i = 0; i < blockSize; i++) {
+            const float* in = &(*r.input)[2 * ((r.inputPos + i) % inputFrames)];
+            if (busL >= 0) r.busses[busL * blockSize + i] = in[0];
+            if (busR >= 0) r.busses[busR * blockSize + i] = in[1];
+        }
+        r.inputPos += blockSize;
+
+        double start = nowSeconds();
+        r.factory->step(r.instance->algorithm, r.busses.data(), blockSize / 4);
+        double elapsed = nowSeconds() - start;
+        total += elapsed;
+        maxBlock = std::max(maxBlock, elapsed);
+
+        r.framesSinceDraw += blockSize;
+        if (r.framesSinceDraw >= drawInterval && r.factory->draw) {
+            r.factory->draw(r.instance->algorithm);
+            r.framesSinceDraw = 0;
+        }
+    }
+    return total;
+}
+
+static bool runScenario(const Scenario& scenario, const std::vector<float>& input,
+                        double seconds, int repeats, Result& result) {
+    // Live scenarios use a short buffer so grains reach recorded audio
+    // within the warm-up
+    std::vector<int32_t> specs = ntStubDefaultSpecifications();
+    if (scenario.source != kSourceSample) specs[ntStubFindSpecification("Live seconds")] = 1;
+
+    NtStubInstance instance;
+    if (!ntStubCreate(instance, specs.data())) return false;
+
+    std::vector<std::string> params = scenario.params;
+    params.push_back(scenario.source == kSourceSample ? "Live Mode=0" : "Live Mode=1");
+    if (scenario.source == kSourceLiveMono) params.push_back("Input R=0");
+    for (size_t i = 0; i < params.size(); i++) {
+        size_t eq = params[i].rfind('=');
+        int index = ntStubFindParameter(instance, params[i].substr(0, eq).c_str());
+        if (index < 0) {
+            fprintf(stderr, "drifters_bench: unknown parameter in '%s'\n", params[i].c_str());
+            ntStubDestroy(instance);
+            return false;
+        }
+        instance.values[index] = (int16_t)atoi(params[i].c_str() + eq + 1);
+    }
+    ntStubAnnounceParameters(instance);
+
+    Runner r;
+    r.factory = instance.factory;
+    r.instance = &instance;
+    r.scenario = &scenario;
+    r.input = &input;
+    r.busses.resize(kStubNumBusses * scenario.blockSize);
+    r.inputPos = 0;
+    r.framesSinceDraw = 0;
+
+    // Warm up with a draw() after every block, so the load and analysis
+    // jobs are done before timing starts
+    double maxBlock;
+    uint64_t warmupFrames = (uint64_t)(kWarmupSeconds * kBenchSampleRate);
+    for (uint64_t frame = 0; frame < warmupFrames; frame += scenario.blockSize) {
+        run(r, scenario.blockSize, maxBlock);
+        if (r.factory->draw) r.factory->draw(instance.algorithm);
+    }
+
+    uint64_t frames = (uint64_t)(seconds * kBenchSampleRate);
+    frames -= frames % scenario.blockSize;
+    double best = 0, bestMaxBlock = 0;
+    for (int i = 0; i < repeats; i++) {
+        double elapsed = run(r, frames, maxBlock);
+        if (i == 0 || elapsed < best) {
+            best = elapsed;
+            bestMaxBlock = maxBlock;
+        }
+    }
+    ntStubDestroy(instance);
+
+    result.name = scenario.name;
+    result.params = join(params, ",");
+    result.nsPerFrame = best * 1e9 / frames;
+    result.framesPerSecond = frames / best;
+    result.maxBlockNs = bestMaxBlock * 1e9;
+    return true;
+}
+
+// ============================================================================
+// RESULTS
+// ============================================================================
+
+static bool writeResults(const char* path, const std::vector<Result>& results) {
+    FILE* f = fopen(path, "w");
+    if (!f) return false;
+    fprintf(f, "[\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        fprintf(f, "  {\"name\": \"%s\", \"params\": \"%s\", \"ns_per_frame\": %.2f, "
+                   "\"frames_per_second\": %.0f, \"max_block_ns\": %.0f}%s\n",
+                r.name.c_str(), r.params.c_str(), r.nsPerFrame, r.framesPerSecond, r.maxBlockNs,
+                (i + 1 < results.size()) ? "," : "");
+    }
+    fprintf(f, "]\n");
+    fclose(f);
+    return true;
+}
+
+// Read back name and ns_per_frame from a file written by writeResults()
+static bool readBaseline(const char* path, std::vector<Result>& baseline) {
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    char line[1024];
+    while (fgets(line, sizeof(line), f)) {
+        const char* name = strstr(line, "\"name\": \"");
+        const char* cost = strstr(line, "\"ns_per_frame\": ");
+        if (!name || !cost) continue;
+        name += strlen("\"name\": \"");
+        const char* end = strchr(name, '"');
+        if (!end) continue;
+        Result r;
+        r.name.assign(name, end);
+        r.nsPerFrame = atof(cost + strlen("\"ns_per_frame\": "));
+        baseline.push_back(r);
+    }
+    fclose(f);
+    return true;
+}
+
+// Print each scenario's change against the baseline; returns the geometric
+// mean ratio (new / old) over the scenarios both runs have
+static double compare(const std::vector<Result>& results, const std::vector<Result>& baseline, double& worst) {
+    double logSum = 0;
+    int count = 0;
+    worst = 0;
+    printf("\n%-58s %10s %10s %8s\n", "scenario", "baseline", "now", "change");
+    for (size_t i = 0; i < results.size(); i++) {
+        for (size_t j = 0; j < baseline.size(); j++) {
+            if (baseline[j].name != results[i].name || baseline[j].nsPerFrame <= 0) continue;
+            double ratio = results[i].nsPerFrame / baseline[j].nsPerFrame;
+            printf("%-58s %10.1f %10.1f %+7.1f%%\n", results[i].name.c_str(),
+                   baseline[j].nsPerFrame, results[i].nsPerFrame, (ratio - 1.0) * 100.0);
+            logSum += log(ratio);
+            count++;
+            worst = std::max(worst, (ratio - 1.0) * 100.0);
+            break;
+        }
+    }
+    return count ? exp(logSum / count) : 1.0;
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+static void usage() {
+    printf("Usage: drifters_bench [options]\n"
+           "\n"
+           "  -o FILE              Write results as JSON\n"
+           "  --baseline FILE      Compare against earlier results\n"
+           "  --fail-over PCT      Exit with 3 if the geometric mean slows by more than PCT%%\n"
+           "  --filter TEXT        Only run scenarios whose name contains TEXT\n"
+           "  -t SECONDS           Timed length of each run (default 2)\n"
+           "  -r REPEATS           Timed runs per scenario, fastest kept (default 3)\n"
+           "  -q                   Don't print per-scenario results\n");
+}
+
+int main(int argc, char** argv) {
+    const char* outputPath = NULL;
+    const char* baselinePath = NULL;
+    const char* filter = NULL;
+    double failOver = -1;
+    double seconds = 2.0;
+    int repeats = 3;
+    bool quiet = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (arg == "-h" || arg == "--help") {
+            usage();
+            return 0;
+        } else if (arg == "-q") {
+            quiet = true;
+        } else if (arg == "-o" && hasValue) {
+            outputPath = argv[++i];
+        } else if (arg == "--baseline" && hasValue) {
+            baselinePath = argv[++i];
+        } else if (arg == "--fail-over" && hasValue) {
+            failOver = atof(argv[++i]);
+        } else if (arg == "--filter" && hasValue) {
+            filter = argv[++i];
+        } else if (arg == "-t" && hasValue) {
+            seconds = atof(argv[++i]);
+        } else if (arg == "-r" && hasValue) {
+            repeats = std::max(1, atoi(argv[++i]));
+        } else {
+            fprintf(stderr, "drifters_bench: unknown option '%s'\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (NT_globals.sampleRate != kBenchSampleRate) {
+        fprintf(stderr, "drifters_bench: run at %uHz (NT_SAMPLE_RATE is %u)\n", kBenchSampleRate, NT_globals.sampleRate);
+        return 1;
+    }
+    if (!ntStubFactory()) {
+        fprintf(stderr, "drifters_bench: plugin has no factory\n");
+        return 1;
+    }
+
+    std::vector<float> sample = makeMaterial(4 * kBenchSampleRate, kBenchSampleRate, 1);
+    std::vector<float> input = makeMaterial(3 * kBenchSampleRate, kBenchSampleRate, 2);
+    ntStubAddSample("bench", "material.wav", sample.data(), (uint32_t)(sample.size() / 2), 2, kBenchSampleRate);
+
+    std::vector<Scenario> scenarios = buildScenarios();
+    std::vector<Result> results;
+    for (size_t i = 0; i < scenarios.size(); i++) {
+        if (filter && scenarios[i].name.find(filter) == std::string::npos) continue;
+        Result result;
+        if (!runScenario(scenarios[i], input, seconds, repeats, result)) return 1;
+        if (!quiet) {
+            printf("%-58s %8.1f ns/frame %6.1fx realtime  max block %.1fus\n", result.name.c_str(),
+                   result.nsPerFrame, result.framesPerSecond / kBenchSampleRate, result.maxBlockNs * 1e-3);
+        }
+        results.push_back(result);
+    }
+
+    if (outputPath && !writeResults(outputPath, results)) {
+        fprintf(stderr, "drifters_bench: can't write %s\n", outputPath);
+        return 1;
+    }
+
+    if (baselinePath) {
+        std::vector<Result> baseline;
+        if (!readBaseline(baselinePath, baseline)) {
+            fprintf(stderr, "drifters_bench: can't read %s\n", baselinePath);
+            return 1;
+        }
+        double worst;
+        double geomean = compare(results, baseline, worst);
+        printf("geometric mean %+.1f%% (worst scenario %+.1f%%)\n", (geomean - 1.0) * 100.0, worst);
+        if (failOver >= 0 && (geomean - 1.0) * 100.0 > failOver) {
+            fprintf(stderr, "drifters_bench: slower than the baseline by more than %.1f%%\n", failOver);
+            return 3;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,159 @@
+/*
+ * Drifters - Cortex-M7 instruction-count benchmarks
+ *
+ * A tiny driver built with the hardware compiler flags (arm-none-eabi,
+ * cortex-m7, -Os) and run under qemu-arm with its instruction-counting
+ * plugin by harness/bench_arm.sh. It runs one scenario: construction and a
+ * warm-up, then FRAMES frames of step() alone. The script runs each scenario
+ * with FRAMES 0 and FRAMES N, so everything but those N frames cancels and
+ * the difference over N is instructions per frame.
+ *
+ *   drifters_bench_arm.elf --list
+ *   drifters_bench_arm.elf SCENARIO FRAMES
+ *
+ * Memory is kept small (one 4-second cache slot, a 1-second live buffer) so
+ * the driver fits the emulator's semihosting heap.
+ */
+
+#include "nt_stub.h"
+#include "material.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+static constexpr uint32_t kArmSampleRate = 48000;
+static constexpr int kArmBlockSize = 32;
+static constexpr uint32_t kWarmupFrames = kArmSampleRate;
+
+struct ArmScenario {
+    const char* name;
+    bool live;
+    const char* params;    // NAME=VALUE,NAME=VALUE
+};
+
+// The quality scenarios share their names with make bench
+static const ArmScenario scenarios[] = {
+    { "sample/Density=0", false, "Density=0" },
+    { "sample/Density=50", false, "Density=50" },
+    { "sample/Density=100", false, "Density=100" },
+    { "sample/Density=75,Spectrum=60", false, "Density=75,Spectrum=60" },
+    { "sample/Density=75,Scale=1,Scatter=7", false, "Density=75,Scale=1,Scatter=7" },
+    { "quality/sample/Quality=0,Density=75,Spectrum=60", false, "Quality=0,Density=75,Spectrum=60" },
+    { "quality/sample/Quality=1,Density=75,Spectrum=60", false, "Quality=1,Density=75,Spectrum=60" },
+    { "quality/sample/Quality=2,Density=75,Spectrum=60", false, "Quality=2,Density=75,Spectrum=60" },
+    { "live-stereo/Density=75,Spectrum=60", true, "Live Mode=1,Density=75,Spectrum=60" },
+};
+
+static const int kNumScenarios = sizeof(scenarios) / sizeof(scenarios[0]);
+
+static bool setSpecification(std::vector<int32_t>& specs, const char* name, int32_t value) {
+    int index = ntStubFindSpecification(name);
+    if (index < 0) return false;
+    specs[index] = value;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc == 2 && !strcmp(argv[1], "--list")) {
+        for (int i = 0; i < kNumScenarios; i++) printf("%s\n", scenarios[i].name);
+        return 0;
+    }
+    if (argc != 3) {
+        fprintf(stderr, "Usage: drifters_bench_arm --list | SCENARIO FRAMES\n");
+        return 1;
+    }
+
+    const ArmScenario* scenario = NULL;
+    for (int i = 0; i < kNumScenarios; i++) {
+        if (!strcmp(argv[1], scenarios[i].name)) scenario = &scenarios[i];
+    }
+    if (!scenario) {
+        fprintf(stderr, "drifters_bench_arm: unknown scenario '%s'\n", argv[1]);
+        return 1;
+    }
+    const uint32_t frames = (uint32_t)atoi(argv[2]);
+    if (frames % kArmBlockSize) {
+        fprintf(stderr, "drifters_bench_arm: FRAMES must be a multiple of %d\n", kArmBlockSize);
+        return 1;
+    }
+
+    std::vector<float> sample = makeMaterial(2 * kArmSampleRate, kArmSampleRate, 1);
+    std::vector<float> input = makeMaterial(kArmSampleRate, kArmSampleRate, 2);
+    ntStubAddSample("bench", "material.wav", sample.data(), (uint32_t)(sample.size() / 2), 2, kArmSampleRate);
+
+    std::vector<int32_t> specs = ntStubDefaultSpecifications();
+    setSpecification(specs, "Cache slots", 1);
+    setSpecification(specs, "Slot seconds", 4);
+    setSpecification(specs, "Live seconds", 1);
+    NtStubInstance instance;
+    if (!ntStubCreate(instance, specs.data())) {
+        fprintf(stderr, "drifters_bench_arm: out of memory\n");
+        return 1;
+    }
+
+    std::string params = scenario->params;
+    size_t start = 0;
+    while (start < params.size()) {
+        size_t end = params.find(',', start);
+        if (end == std::string::npos) end = params.size();
+        std::string assignment = params.substr(start, end - start);
+        size_t eq = assignment.find('=');
+        int index = ntStubFindParameter(instance, assignment.substr(0, eq).c_str());
+        if (index < 0) {
+            fprintf(stderr, "drifters_bench_arm: unknown parameter in '%s'\n", assignment.c_str());
+            return 1;
+        }
+        instance.values[index] = (int16_t)atoi(assignment.c_str() + eq + 1);
+        start = end + 1;
+    }
+
+    // Every output replaces its bus, so the busses needn't be cleared between
+    // blocks and the measured frames hold little besides step() itself
+    static const char* const outputModes[] = { "Out L mode", "Out R mode", "Position mode", "Pulse mode" };
+    for (int i = 0; i < 4; i++) {
+        int index = ntStubFindParameter(instance, outputModes[i]);
+        if (index >= 0) instance.values[index] = 1;
+    }
+    ntStubAnnounceParameters(instance);
+
+    std::vector<float> busses(kStubNumBusses * kArmBlockSize);
+    const int busL = ntStubAudioBus(instance, kNT_unitAudioInput, 0);
+    const int busR = ntStubAudioBus(instance, kNT_unitAudioInput, 1);
+    const int outL = ntStubAudioBus(instance, kNT_unitAudioOutput, 0);
+    const uint32_t inputFrames = (uint32_t)(input.size() / 2);
+    uint32_t inputPos = 0;
+    double sumSquares = 0;
+
+    // Warm up with a draw() after every block so the load and analysis jobs
+    // finish; the measured frames then leave draw() out altogether
+    for (uint32_t frame = 0; frame < kWarmupFrames + frames; frame += kArmBlockSize) {
+        bool warmup = frame < kWarmupFrames;
+        if (warmup) ntStubPumpLoads();
+        if (scenario->live) {
+            for (int i = 0; i < kArmBlockSize; i++) {
+                const float* in = &input[2 * inputPos];
+                busses[busL * kArmBlockSize + i] = in[0];
+                busses[busR * kArmBlockSize + i] = in[1];
+                if (++inputPos == inputFrames) inputPos = 0;
+            }
+        }
+        instance.factory->step(instance.algorithm, busses.data(), kArmBlockSize / 4);
+        if (warmup) {
+            if (instance.factory->draw) instance.factory->draw(instance.algorithm);
+            for (int i = 0; i < kArmBlockSize; i++) {
+                float x = busses[outL * kArmBlockSize + i];
+                sumSquares += x * x;
+            }
+        }
+    }
+
+    // Warm-up level only, so the report shows the scenario made sound
+    // without adding work to the measured frames
+    printf("%s: %u frames, warm-up rms %.4f\n", scenario->name, (unsigned)frames, sqrt(sumSquares / kWarmupFrames));
+    ntStubDestroy(instance);
+    return 0;
+}
@@ -0,0 +1,57 @@
+#!/bin/sh
+#
+# Drifters - Cortex-M7 instruction-count benchmarks
+#
+# Runs every scenario of the bench_arm driver under qemu-arm with the
+# instruction-counting plugin (libinsn.so from a QEMU build, contrib/plugins
+# or tests/plugin), twice - with 0 and with FRAMES measured frames - and
+# reports the difference per frame. JSON goes to stdout, a table to stderr.
+#
+#   bench_arm.sh DRIVER PLUGIN [FRAMES]
+#
+# QEMU_ARM (default qemu-arm) and QEMU_CPU (default cortex-m7) pick the
+# emulator.
+
+set -e
+
+DRIVER=$1
+PLUGIN=$2
+FRAMES=${3:-48000}
+QEMU_ARM=${QEMU_ARM:-qemu-arm}
+QEMU_CPU=${QEMU_CPU:-cortex-m7}
+
+if [ -z "$DRIVER" ] || [ -z "$PLUGIN" ]; then
+    echo "Usage: bench_arm.sh DRIVER PLUGIN [FRAMES]" >&2
+    exit 1
+fi
+if [ ! -f "$PLUGIN" ]; then
+    echo "bench_arm.sh: no instruction-count plugin at $PLUGIN" >&2
+    exit 1
+fi
+
+LOG=$(mktemp)
+trap 'rm -f "$LOG"' EXIT
+
+# Instructions executed by one run of the driver
+count() {
+    "$QEMU_ARM" -cpu "$QEMU_CPU" -plugin "$PLUGIN" -d plugin -D "$LOG" "$DRIVER" "$1" "$2" >&2
+    # libinsn prints per-CPU lines before the total; the last count wins
+    awk '/insns:/ { n = $NF } END { print n }' "$LOG"
+}
+
+SCENARIOS=$("$QEMU_ARM" -cpu "$QEMU_CPU" "$DRIVER" --list)
+
+printf '%-52s %14s\n' "scenario" "insns/frame" >&2
+echo "["
+FIRST=1
+for SCENARIO in $SCENARIOS; do
+    BASE=$(count "$SCENARIO" 0)
+    TOTAL=$(count "$SCENARIO" "$FRAMES")
+    PER_FRAME=$(awk -v a="$BASE" -v b="$TOTAL" -v n="$FRAMES" 'BEGIN { printf "%.1f", (b - a) / n }')
+    printf '%-52s %14s\n' "$SCENARIO" "$PER_FRAME" >&2
+    [ $FIRST -eq 1 ] || echo ","
+    FIRST=0
+    printf '  {"name": "%s", "frames": %s, "instructions_per_frame": %s}' "$SCENARIO" "$FRAMES" "$PER_FRAME"
+done
+echo
+echo "]"
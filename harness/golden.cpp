@@ -0,0 +1,461 @@
+/*
+ * Drifters - golden-output tests
+ *
+ * Renders fixed scenarios on synthetic material and compares them with
+ * references in harness/golden/, so a change meant to leave the sound alone
+ * (an optimisation, a refactor) can be shown to.
+ *
+ *   drifters_golden                 compare every scenario
+ *   drifters_golden --update        rewrite the references
+ *
+ * A reference is a fingerprint rather than audio: for each window of each
+ * channel, its RMS and its projection onto a fixed random +-1 sequence.
+ * The projection follows the waveform itself, so the projection error is
+ * close to the RMS of the difference signal relative to the reference -
+ * that is the number checked against the tolerance. The RMS envelope is
+ * reported alongside as a coarser view of the same change.
+ *
+ * Every scenario is also rendered twice from fresh instances and must come
+ * out bit-identical: with a fixed Seed, a render is fully deterministic.
+ *
+ * A tier check then drives the engine core directly. Every Quality tier
+ * must move at the same speed: a storm must decay, and a parameter change
+ * must settle, at the same rate whatever the tier costs.
+ */
+
+#include "nt_stub.h"
+#include "material.h"
+#include "drifters_engine.h"
+
+#include <math.h>
+#include <cmath>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+// ============================================================================
+// SCENARIOS
+// ============================================================================
+
+static constexpr uint32_t kGoldenSampleRate = 48000;
+static constexpr int kGoldenBlockSize = 32;
+static constexpr int kWindowFrames = 1024;
+static constexpr double kDrawRate = 30.0;
+static constexpr double kDefaultTolerance = 1e-3;   // -60dB
+
+struct GoldenChange {
+    double seconds;
+    const char* assignment;    // NAME=VALUE
+};
+
+struct GoldenScenario {
+    const char* name;
+    bool live;                                  // Input from live material instead of a sample
+    double seconds;
+    std::vector<const char*> specs;             // NAME=VALUE
+    std::vector<const char*> params;            // NAME=VALUE
+    std::vector<GoldenChange> changes;
+};
+
+static std::vector<GoldenScenario> buildScenarios() {
+    std::vector<GoldenScenario> s;
+    s.push_back({ "sample-default", false, 4.0, {}, {}, {} });
+    s.push_back({ "sample-seed", false, 4.0, { "Seed=1234" }, {}, {} });
+    s.push_back({ "sample-dense", false, 4.0, {},
+                  { "Density=90", "Shape=2", "Spectrum=60", "Tilt=30", "Scale=1", "Scatter=7", "Entropy=60" }, {} });
+    s.push_back({ "sample-eco", false, 4.0, {}, { "Quality=0", "Density=75", "Spectrum=40" }, {} });
+    s.push_back({ "sample-hq", false, 4.0, {}, { "Quality=2", "Density=75", "Spectrum=40" }, {} });
+    s.push_back({ "sample-resampled", false, 4.0, { "Resample=1", "16-bit cache=1" },
+                  { "Sample=1", "Pitch=-5", "Density=60" }, {} });
+    s.push_back({ "sample-automation", false, 4.0, {}, { "Density=70" },
+                  { { 1.0, "Pitch=7" }, { 1.5, "Drift=90" }, { 2.0, "Gravity=-60" },
+                    { 2.5, "Shape=4" }, { 3.0, "Anchor=10" }, { 3.5, "Mix=50" } } });
+    s.push_back({ "live-stereo", true, 4.0, { "Live seconds=1" }, { "Live Mode=1", "Density=70" }, {} });
+    s.push_back({ "live-freeze", true, 4.0, { "Live seconds=1" }, { "Live Mode=1", "Density=80", "Spectrum=50" },
+                  { { 2.0, "Freeze=1" } } });
+    return s;
+}
+
+// ============================================================================
+// RENDERING
+// ============================================================================
+
+struct Render {
+    std::vector<float> frames;    // Interleaved Out L/R
+};
+
+// Resolve NAME=VALUE to a parameter index and value
+static bool parseParameter(const NtStubInstance& instance, const char* text, int& index, int& value) {
+    std::string s = text;
+    size_t eq = s.rfind('=');
+    if (eq == std::string::npos) return false;
+    index = ntStubFindParameter(instance, s.substr(0, eq).c_str());
+    value = atoi(text + eq + 1);
+    return index >= 0;
+}
+
+static bool render(const GoldenScenario& scenario, const std::vector<float>& input, Render& out) {
+    std::vector<int32_t> specs = ntStubDefaultSpecifications();
+    for (size_t i = 0; i < scenario.specs.size(); i++) {
+        std::string s = scenario.specs[i];
+        size_t eq = s.rfind('=');
+        int index = ntStubFindSpecification(s.substr(0, eq).c_str());
+        if (index < 0) {
+            fprintf(stderr, "drifters_golden: unknown specification in '%s'\n", scenario.specs[i]);
+            return false;
+        }
+        specs[index] = atoi(scenario.specs[i] + eq + 1);
+    }
+
+    NtStubInstance instance;
+    if (!ntStubCreate(instance, specs.data())) return false;
+    for (size_t i = 0; i < scenario.params.size(); i++) {
+        int index, value;
+        if (!parseParameter(instance, scenario.params[i], index, value)) {
+            fprintf(stderr, "drifters_golden: unknown parameter in '%s'\n", scenario.params[i]);
+            ntStubDestroy(instance);
+            return false;
+        }
+        instance.values[index] = (int16_t)value;
+    }
+    ntStubAnnounceParameters(instance);
+
+    const uint64_t totalFrames = (uint64_t)(scenario.seconds * kGoldenSampleRate);
+    const uint64_t drawInterval = (uint64_t)(kGoldenSampleRate / kDrawRate);
+    const uint64_t inputFrames = input.size() / 2;
+    std::vector<float> busses(kStubNumBusses * kGoldenBlockSize);
+    out.frames.clear();
+    out.frames.reserve(totalFrames * 2);
+    size_t nextChange = 0;
+    uint64_t nextDraw = 0;
+
+    for (uint64_t frame = 0; frame < totalFrames; frame += kGoldenBlockSize) {
+        ntStubPumpLoads();
+
+        while (nextChange < scenario.changes.size() &&
+               scenario.changes[nextChange].seconds * kGoldenSampleRate <= frame) {
+            int index, value;
+            if (!parseParameter(instance, scenario.changes[nextChange].assignment, index, value)) {
+                fprintf(stderr, "drifters_golden: unknown parameter in '%s'\n", scenario.changes[nextChange].assignment);
+                ntStubDestroy(instance);
+                return false;
+            }
+            ntStubSetParameter(index, (int16_t)value);
+            nextChange++;
+        }
+
+        std::fill(busses.begin(), busses.end(), 0.0f);
+        if (scenario.live) {
+            int busL = ntStubAudioBus(instance, kNT_unitAudioInput, 0);
+            int busR = ntStubAudioBus(instance, kNT_unitAudioInput, 1);
+            for (int i = 0; i < kGoldenBlockSize; i++) {
+                const float* in = &input[2 * ((frame + i) % inputFrames)];
+                if (busL >= 0) busses[busL * kGoldenBlockSize + i] = in[0];
+                if (busR >= 0) busses[busR * kGoldenBlockSize + i] = in[1];
+            }
+        }
+
+        instance.factory->step(instance.algorithm, busses.data(), kGoldenBlockSize / 4);
+
+        if (frame >= nextDraw && instance.factory->draw) {
+            instance.factory->draw(instance.algorithm);
+            nextDraw += drawInterval;
+        }
+
+        int outL = ntStubAudioBus(instance, kNT_unitAudioOutput, 0);
+        int outR = ntStubAudioBus(instance, kNT_unitAudioOutput, 1);
+        for (int i = 0; i < kGoldenBlockSize && frame + i < totalFrames; i++) {
+            out.frames.push_back(busses[outL * kGoldenBlockSize + i]);
+            out.frames.push_back(busses[outR * kGoldenBlockSize + i]);
+        }
+    }
+    ntStubDestroy(instance);
+    return true;
+}
+
+// ============================================================================
+// FINGERPRINTS
+// ============================================================================
+
+// Per window: RMS and projection of Out L, then of Out R
+struct Fingerprint {
+    std::vector<double> rms;
+    std::vector<double> projection;
+};
+
+static Fingerprint fingerprint(const Render& render) {
+    Fingerprint f;
+    const size_t numFrames = render.frames.size() / 2;
+    for (size_t start = 0; start + kWindowFrames <= numFrames; start += kWindowFrames) {
+        for (int channel = 0; channel < 2; channel++) {
+            // The same sequence for every window, so a time-shifted copy
+            // doesn't pass for the original
+            uint32_t state = 0x2545F491u + channel;
+            double squares = 0, projection = 0;
+            for (int i = 0; i < kWindowFrames; i++) {
+                double x = render.frames[2 * (start + i) + channel];
+                squares += x * x;
+                projection += (materialNoise(state) < 0.0f) ? -x : x;
+            }
+            f.rms.push_back(sqrt(squares / kWindowFrames));
+            f.projection.push_back(projection);
+        }
+    }
+    return f;
+}
+
+static bool writeFingerprint(const char* path, const Fingerprint& f) {
+    FILE* file = fopen(path, "w");
+    if (!file) return false;
+    fprintf(file, "# window rms_l projection_l rms_r projection_r (%d frames per window)\n", kWindowFrames);
+    for (size_t w = 0; w < f.rms.size() / 2; w++) {
+        fprintf(file, "%zu %.9g %.9g %.9g %.9g\n", w,
+                f.rms[2 * w], f.projection[2 * w], f.rms[2 * w + 1], f.projection[2 * w + 1]);
+    }
+    fclose(file);
+    return true;
+}
+
+static bool readFingerprint(const char* path, Fingerprint& f) {
+    FILE* file = fopen(path, "r");
+    if (!file) return false;
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        if (line[0] == '#') continue;
+        size_t w;
+        double rmsL, projectionL, rmsR, projectionR;
+        if (sscanf(line, "%zu %lg %lg %lg %lg", &w, &rmsL, &projectionL, &rmsR, &projectionR) != 5) continue;
+        f.rms.push_back(rmsL);
+        f.projection.push_back(projectionL);
+        f.rms.push_back(rmsR);
+        f.projection.push_back(projectionR);
+    }
+    fclose(file);
+    return !f.rms.empty();
+}
+
+// Relative errors of a render against its reference (see the top of the file)
+static void compare(const Fingerprint& now, const Fingerprint& reference,
+                    double& waveformError, double& envelopeError) {
+    double difference = 0, power = 0, rmsDifference = 0;
+    for (size_t i = 0; i < reference.rms.size(); i++) {
+        double d = now.projection[i] - reference.projection[i];
+        difference += d * d;
+        power += reference.rms[i] * reference.rms[i] * kWindowFrames;
+        double r = now.rms[i] - reference.rms[i];
+        rmsDifference += r * r;
+    }
+    power = std::max(power, 1e-20);
+    waveformError = sqrt(difference / power);
+    envelopeError = sqrt(rmsDifference * kWindowFrames / power);
+}
+
+// ============================================================================
+// TIER CHECK
+// ============================================================================
+
+static constexpr double kTierTolerance = 0.1;   // Relative; tiers update on different frames
+
+// Engine state a while after the Storm gate drops and Anchor jumps
+struct TierTrace {
+    float storm;           // stormLevel 1s after the gate drops
+    float anchorResidual;  // How far anchorSmooth is from its target 100ms after the jump
+};
+
+// With the material in the cache, hold Storm for half a second,
+// then release it and move Anchor 50% -> 90%
+static void traceTier(int quality, const std::vector<float>& material, TierTrace& trace) {
+    const int32_t frames = (int32_t)(material.size() / 2);
+    EngineConfig config = { 1, frames, false, 0.0f, 4096, 0 };
+    std::vector<uint8_t> dtcMemory(sizeof(_driftEngine_DTC));
+    std::vector<uint8_t> dramMemory(engineDramBytes(config));
+    DriftEngine engine;
+    engineInit(&engine, dtcMemory.data(), dramMemory.data(), config);
+
+    SampleSlot& slot = engine.dram->slots[0];
+    for (int32_t i = 0; i < frames; i++) slot.frames[i] = material[2 * i];
+    slot.folder = 0;
+    slot.sample = 0;
+    engineSlotLoaded(&engine, 0, frames, (float)kGoldenSampleRate);
+
+    EngineParams params;
+    memset(&params, 0, sizeof(params));
+    params.mix = 100;
+    params.anchor = 50;
+    params.wander = 30;
+    params.drift = 30;
+    params.density = 50;
+    params.deviation = 100;
+    params.shape = 1;
+    params.entropy = 25;
+    params.quality = (int16_t)quality;
+
+    std::vector<float> storm(kGoldenBlockSize), outL(kGoldenBlockSize), outR(kGoldenBlockSize);
+    std::vector<float> scratch(4 * (kHalfBandTaps + kGoldenBlockSize));
+    EngineBuffers buffers;
+    memset(&buffers, 0, sizeof(buffers));
+    buffers.numFrames = kGoldenBlockSize;
+    buffers.sampleRate = (float)kGoldenSampleRate;
+    buffers.cvStorm = storm.data();
+    buffers.outL = outL.data();
+    buffers.outR = outR.data();
+    buffers.replaceL = true;
+    buffers.replaceR = true;
+    buffers.scratch = scratch.data();
+    buffers.scratchBytes = (uint32_t)(scratch.size() * sizeof(float));
+
+    const int release = kGoldenSampleRate / 2 / kGoldenBlockSize;
+    const int settled = release + kGoldenSampleRate / 10 / kGoldenBlockSize;
+    const int decayed = release + kGoldenSampleRate / kGoldenBlockSize;
+    for (int block = 0; block < decayed; block++) {
+        if (block == release) params.anchor = 90;
+        std::fill(storm.begin(), storm.end(), block < release ? 5.0f : 0.0f);
+        engineRender(&engine, params, buffers);
+        if (block + 1 == settled) trace.anchorResidual = 0.9f - engine.dtc->anchorSmooth;
+    }
+    trace.storm = engine.dtc->stormLevel;
+}
+
+// Every tier against Normal; returns false on a mismatch
+static bool checkTiers(const std::vector<float>& material) {
+    TierTrace traces[kNumQualities];
+    for (int q = 0; q < kNumQualities; q++) traceTier(q, material, traces[q]);
+
+    const TierTrace& normal = traces[kQualityNormal];
+    bool pass = true;
+    for (int q = 0; q < kNumQualities; q++) {
+        double storm = fabs(traces[q].storm / normal.storm - 1.0);
+        double anchor = fabs(traces[q].anchorResidual / normal.anchorResidual - 1.0);
+        if (!(storm <= kTierTolerance && anchor <= kTierTolerance)) pass = false;
+    }
+    printf("%-20s %s storm", "tier-decay", pass ? "ok  " : "FAIL");
+    for (int q = 0; q < kNumQualities; q++) printf(" %.3g", traces[q].storm);
+    printf(" anchor");
+    for (int q = 0; q < kNumQualities; q++) printf(" %.3g", traces[q].anchorResidual);
+    printf(" (Eco, Normal, HQ)\n");
+    return pass;
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+static void usage() {
+    printf("Usage: drifters_golden [options]\n"
+           "\n"
+           "  --update             Rewrite the references from this build\n"
+           "  --dir DIR            Reference directory (default harness/golden)\n"
+           "  --tolerance X        Largest relative waveform error allowed (default %g)\n"
+           "  --filter TEXT        Only run scenarios whose name contains TEXT\n"
+           "  -o DIR               Also write each render as a WAV file in DIR\n",
+           kDefaultTolerance);
+}
+
+int main(int argc, char** argv) {
+    const char* directory = "harness/golden";
+    const char* filter = NULL;
+    const char* wavDirectory = NULL;
+    double tolerance = kDefaultTolerance;
+    bool update = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (arg == "-h" || arg == "--help") {
+            usage();
+            return 0;
+        } else if (arg == "--update") {
+            update = true;
+        } else if (arg == "--dir" && hasValue) {
+            directory = argv[++i];
+        } else if (arg == "--tolerance" && hasValue) {
+            tolerance = atof(argv[++i]);
+        } else if (arg == "--filter" && hasValue) {
+            filter = argv[++i];
+        } else if (arg == "-o" && hasValue) {
+            wavDirectory = argv[++i];
+        } else {
+            fprintf(stderr, "drifters_golden: unknown option '%s'\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (NT_globals.sampleRate != kGoldenSampleRate) {
+        fprintf(stderr, "drifters_golden: run at %uHz (NT_SAMPLE_RATE is %u)\n", kGoldenSampleRate, NT_globals.sampleRate);
+        return 1;
+    }
+    if (!ntStubFactory()) {
+        fprintf(stderr, "drifters_golden: plugin has no factory\n");
+        return 1;
+    }
+
+    // Sample 0 at the engine rate, sample 1 at 44.1kHz for the resampler
+    std::vector<float> sample = makeMaterial(4 * kGoldenSampleRate, kGoldenSampleRate, 1);
+    std::vector<float> sample44 = makeMaterial(3 * 44100, 44100, 3);
+    std::vector<float> input = makeMaterial(3 * kGoldenSampleRate, kGoldenSampleRate, 2);
+    ntStubAddSample("golden", "material.wav", sample.data(), (uint32_t)(sample.size() / 2), 2, kGoldenSampleRate);
+    ntStubAddSample("golden", "material44.wav", sample44.data(), (uint32_t)(sample44.size() / 2), 2, 44100);
+
+    std::vector<GoldenScenario> scenarios = buildScenarios();
+    int failures = 0;
+    for (size_t i = 0; i < scenarios.size(); i++) {
+        const GoldenScenario& scenario = scenarios[i];
+        if (filter && !strstr(scenario.name, filter)) continue;
+
+        Render first, second;
+        if (!render(scenario, input, first) || !render(scenario, input, second)) return 1;
+        bool deterministic = (first.frames == second.frames);
+        bool finite = true;
+        for (size_t j = 0; j < first.frames.size(); j++) {
+            if (!std::isfinite(first.frames[j])) finite = false;
+        }
+
+        std::string path = std::string(directory) + "/" + scenario.name + ".txt";
+        Fingerprint now = fingerprint(first);
+        if (wavDirectory) {
+            std::string wav = std::string(wavDirectory) + "/" + scenario.name + ".wav";
+            ntStubWriteWav(wav.c_str(), first.frames.data(), (uint32_t)(first.frames.size() / 2), 2, kGoldenSampleRate);
+        }
+
+        if (update) {
+            if (!writeFingerprint(path.c_str(), now)) {
+                fprintf(stderr, "drifters_golden: can't write %s\n", path.c_str());
+                return 1;
+            }
+            printf("%-20s updated%s%s\n", scenario.name,
+                   deterministic ? "" : " NOT DETERMINISTIC", finite ? "" : " NON-FINITE");
+            if (!deterministic || !finite) failures++;
+            continue;
+        }
+
+        Fingerprint reference;
+        if (!readFingerprint(path.c_str(), reference)) {
+            printf("%-20s FAIL no reference (%s)\n", scenario.name, path.c_str());
+            failures++;
+            continue;
+        }
+        if (reference.rms.size() != now.rms.size()) {
+            printf("%-20s FAIL length %zu windows, reference has %zu\n", scenario.name,
+                   now.rms.size() / 2, reference.rms.size() / 2);
+            failures++;
+            continue;
+        }
+        double waveformError, envelopeError;
+        compare(now, reference, waveformError, envelopeError);
+        bool pass = deterministic && finite && waveformError <= tolerance;
+        printf("%-20s %s waveform %.2e envelope %.2e%s%s\n", scenario.name, pass ? "ok  " : "FAIL",
+               waveformError, envelopeError, deterministic ? "" : " NOT DETERMINISTIC", finite ? "" : " NON-FINITE");
+        if (!pass) failures++;
+    }
+
+    if ((!filter || strstr("tier-decay", filter)) && !checkTiers(sample)) failures++;
+
+    if (failures) {
+        fprintf(stderr, "drifters_golden: %d scenario%s failed\n", failures, failures == 1 ? "" : "s");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,583 @@
+/*
+ * Drifters - headless host harness
+ *
+ * Runs the plugin from the command line against the stub NT API: construct,
+ * set parameters, step block by block and write the output to WAV.
+ *
+ *   drifters_host --samples ~/samples -t 30 -o out.wav Density=80 Shape=Rain
+ *   drifters_host --samples ~/samples --replay session.log -o replay.wav
+ *
+ * Run with --help for the options, --list for parameter names.
+ */
+
+#include "nt_stub.h"
+
+#include <math.h>
+#include <cmath>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+// ============================================================================
+// COMMAND LINE
+// ============================================================================
+
+// A parameter change at a point in the render
+struct ScheduledChange {
+    double seconds;
+    int parameter;
+    int value;
+};
+
+struct HostOptions {
+    const char* outputPath;
+    const char* samplesPath;
+    const char* inputPath;
+    const char* recordPath;        // Session log to write (DRIFTERS_RECORD builds)
+    const char* replayPath;        // Session log to replay
+    double seconds;
+    bool secondsSet;
+    bool blockSizeSet;
+    int blockSize;
+    double drawRate;               // draw() calls per second (0 = never)
+    bool list;
+    bool quiet;
+    bool screen;
+    std::vector<std::string> specs;        // NAME=VALUE
+    std::vector<std::string> params;       // NAME=VALUE
+    std::vector<std::string> changes;      // SECONDS:NAME=VALUE
+};
+
+static void usage() {
+    printf("Usage: drifters_host [options] [NAME=VALUE ...]\n"
+           "\n"
+           "  NAME=VALUE           Set a parameter before rendering (name or index;\n"
+           "                       '_' stands for a space, case is ignored)\n"
+           "  -o FILE              Write Out L/R as a 32-bit float stereo WAV\n"
+           "  -t SECONDS           Render length (default 10)\n"
+           "  -b FRAMES            Block size, a multiple of 4 (default 32)\n"
+           "  --samples DIR        Sample folders (subdirectories of WAV files)\n"
+           "  --input FILE         WAV looped into the Input L/R busses (Live Mode)\n"
+           "  --spec NAME=VALUE    Set a specification\n"
+           "  --at SECONDS:NAME=VALUE  Change a parameter during the render\n"
+           "  --draw-rate HZ       draw() calls per second (default 30, 0 = never)\n"
+           "  --record FILE        Log the session to FILE (build with RECORD=1)\n"
+           "  --replay FILE        Replay a session log: its specifications, block size,\n"
+           "                       parameter changes and CV; NAME=VALUE pins a parameter\n"
+           "  --list               List parameters and specifications\n"
+           "  --screen             Print the text of the last draw() at the end\n"
+           "  -q                   Only print errors\n"
+           "\n"
+           "The sample rate is NT_SAMPLE_RATE from the environment (default 48000).\n");
+}
+
+static bool parseOptions(int argc, char** argv, HostOptions& opt) {
+    opt.outputPath = NULL;
+    opt.samplesPath = NULL;
+    opt.inputPath = NULL;
+    opt.recordPath = NULL;
+    opt.replayPath = NULL;
+    opt.seconds = 10.0;
+    opt.secondsSet = false;
+    opt.blockSizeSet = false;
+    opt.blockSize = 32;
+    opt.drawRate = 30.0;
+    opt.list = false;
+    opt.quiet = false;
+    opt.screen = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (arg == "-h" || arg == "--help") {
+            usage();
+            exit(0);
+        } else if (arg == "--list") {
+            opt.list = true;
+        } else if (arg == "-q") {
+            opt.quiet = true;
+        } else if (arg == "--screen") {
+            opt.screen = true;
+        } else if (arg == "-o" && hasValue) {
+            opt.outputPath = argv[++i];
+        } else if (arg == "-t" && hasValue) {
+            opt.seconds = atof(argv[++i]);
+            opt.secondsSet = true;
+        } else if (arg == "-b" && hasValue) {
+            opt.blockSize = atoi(argv[++i]);
+            opt.blockSizeSet = true;
+        } else if (arg == "--samples" && hasValue) {
+            opt.samplesPath = argv[++i];
+        } else if (arg == "--input" && hasValue) {
+            opt.inputPath = argv[++i];
+        } else if (arg == "--spec" && hasValue) {
+            opt.specs.push_back(argv[++i]);
+        } else if (arg == "--at" && hasValue) {
+            opt.changes.push_back(argv[++i]);
+        } else if (arg == "--draw-rate" && hasValue) {
+            opt.drawRate = atof(argv[++i]);
+        } else if (arg == "--record" && hasValue) {
+            opt.recordPath = argv[++i];
+        } else if (arg == "--replay" && hasValue) {
+            opt.replayPath = argv[++i];
+        } else if (arg.find('=') != std::string::npos && arg[0] != '-') {
+            opt.params.push_back(arg);
+        } else {
+            fprintf(stderr, "drifters_host: unknown option '%s'\n", argv[i]);
+            return false;
+        }
+    }
+
+#ifndef DRIFTERS_RECORD
+    if (opt.recordPath) {
+        fprintf(stderr, "drifters_host: --record needs a recording build (make host RECORD=1)\n");
+        return false;
+    }
+#endif
+    return true;
+}
+
+static bool checkBlockSize(int blockSize) {
+    if (blockSize < 4 || blockSize % 4 || blockSize > (int)NT_globals.maxFramesPerStep) {
+        fprintf(stderr, "drifters_host: block size must be a multiple of 4 up to %u\n", NT_globals.maxFramesPerStep);
+        return false;
+    }
+    return true;
+}
+
+// Split NAME=VALUE and resolve NAME with the given lookup
+template <typename Find>
+static bool parseAssignment(const std::string& text, Find find, int& index, int& value) {
+    size_t eq = text.rfind('=');
+    if (eq == std::string::npos) return false;
+    index = find(text.substr(0, eq).c_str());
+    if (index < 0) {
+        fprintf(stderr, "drifters_host: unknown name in '%s' (try --list)\n", text.c_str());
+        return false;
+    }
+    value = atoi(text.c_str() + eq + 1);
+    return true;
+}
+
+static void listNames(const _NT_factory* factory, const _NT_algorithm* algorithm, int numParameters) {
+    printf("Specifications:\n");
+    for (uint32_t i = 0; i < factory->numSpecifications; i++) {
+        const _NT_specification& s = factory->specifications[i];
+        printf("  %2u  %-16s %d..%d (default %d)\n", i, s.name, s.min, s.max, s.def);
+    }
+    printf("Parameters:\n");
+    for (int i = 0; i < numParameters; i++) {
+        const _NT_parameter& p = algorithm->parameters[i];
+        printf("  %2d  %-16s %d..%d (default %d)", i, p.name, p.min, p.max, p.def);
+        if (p.enumStrings) {
+            printf("  ");
+            for (int e = 0; e <= p.max - p.min && p.enumStrings[e]; e++) {
+                printf("%s%d=%s", e ? ", " : "", p.min + e, p.enumStrings[e]);
+            }
+        }
+        printf("\n");
+    }
+}
+
+// ============================================================================
+// SESSION REPLAY
+// ============================================================================
+
+// One line of a session log written by a DRIFTERS_RECORD build (see the
+// SESSION RECORDING section of drifters.cpp)
+struct SessionEntry {
+    uint64_t frame;
+    std::string kind;
+    int index;         // param/cv/edge: parameter; block: size; loads: folder
+    int value;         // param: value; edge: level; loads: sample
+    float level;       // cv: block mean; load/loaded: frames
+};
+
+struct Session {
+    uint32_t sampleRate;
+    std::vector<std::pair<int, int32_t>> specs;
+    int blockSize;
+    uint64_t length;                   // Frames up to the end of the last event's block
+    std::vector<SessionEntry> params;  // In frame order
+    std::vector<SessionEntry> cv;      // cv and edge entries, in frame order
+    std::vector<SessionEntry> transfers;   // load entries, in frame order
+    std::vector<SessionEntry> landings;    // loaded and load-failed entries, in frame order
+    int loads;                         // Transfers and cache switches logged
+    bool lostEvents;
+};
+
+static bool readSession(const char* path, Session& session) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "drifters_host: can't read %s\n", path);
+        return false;
+    }
+    session.sampleRate = 0;
+    session.blockSize = 0;
+    session.length = 0;
+    session.loads = 0;
+    session.lostEvents = false;
+
+    char line[256];
+    int lineNumber = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), f)) {
+        lineNumber++;
+        char kind[32];
+        unsigned long long frame;
+        int a, b;
+        float lo, hi, mean;
+        if (line[0] == '#') {
+            if (strstr(line, "lost")) session.lostEvents = true;
+        } else if (sscanf(line, "rate %u", &session.sampleRate) == 1) {
+        } else if (sscanf(line, "spec %d %d", &a, &b) == 2) {
+            session.specs.push_back(std::make_pair(a, (int32_t)b));
+        } else if (sscanf(line, "%llu %31s", &frame, kind) == 2) {
+            SessionEntry e = { frame, kind, 0, 0, 0 };
+            const char* args = strstr(line, kind) + strlen(kind);
+            if (e.kind == "block" && sscanf(args, "%d", &e.index) == 1) {
+                if (!session.blockSize) session.blockSize = e.index;
+                session.length = std::max(session.length, (uint64_t)(frame + e.index));
+            } else if (e.kind == "param" && sscanf(args, "%d %d", &e.index, &e.value) == 2) {
+                session.params.push_back(e);
+            } else if (e.kind == "cv" && sscanf(args, "%d %f %f %f", &e.index, &lo, &hi, &mean) == 4) {
+                e.level = mean;
+                session.cv.push_back(e);
+            } else if (e.kind == "edge" && sscanf(args, "%d %d", &e.index, &e.value) == 2) {
+                e.level = e.value ? 5.0f : 0.0f;
+                session.cv.push_back(e);
+            } else if (e.kind == "load" && sscanf(args, "%d %d %f", &e.index, &e.value, &e.level) == 3) {
+                session.transfers.push_back(e);
+                session.loads++;
+            } else if (e.kind == "cached") {
+                session.loads++;
+            } else if ((e.kind == "loaded" || e.kind == "load-failed") &&
+                       sscanf(args, "%d %d", &e.index, &e.value) == 2) {
+                session.landings.push_back(e);
+            } else if (e.kind != "end") {
+                ok = false;
+            }
+            session.length = std::max(session.length, (uint64_t)(e.kind == "end" ? frame : frame + session.blockSize));
+        } else if (line[0] != '\n') {
+            ok = false;
+        }
+    }
+    fclose(f);
+    if (!ok) fprintf(stderr, "drifters_host: %s:%d: not a session log line\n", path, lineNumber);
+    return ok;
+}
+
+// Where a replay is in the session's loads
+struct LoadReplay {
+    size_t nextTransfer;
+    size_t nextLanding;
+    int32_t transferFrames;    // Frames the newest transfer reads
+};
+
+// Land the outstanding sample read when the session did: the last chunk of
+// a transfer is held until its logged `loaded` frame, and a read that failed
+// in the session fails at its `load-failed` frame. Other reads (earlier
+// chunks, and whatever the session never saw land) complete at once.
+static void replayLoads(const Session& session, LoadReplay& replay, uint64_t frame) {
+    while (replay.nextTransfer < session.transfers.size() && session.transfers[replay.nextTransfer].frame <= frame) {
+        replay.transferFrames = (int32_t)session.transfers[replay.nextTransfer++].level;
+    }
+
+    _NT_wavRequest request;
+    bool pending = ntStubPendingLoad(request);
+    const SessionEntry* landing = NULL;
+    bool matches = false;
+    while (replay.nextLanding < session.landings.size()) {
+        landing = &session.landings[replay.nextLanding];
+        matches = pending && landing->index == (int)request.folder && landing->value == (int)request.sample;
+        // A landing nothing is waiting for once its frame has passed belongs
+        // to a load this replay didn't make
+        if (matches || landing->frame >= frame) break;
+        replay.nextLanding++;
+        landing = NULL;
+    }
+    if (!pending) return;
+
+    bool lastChunk = (int64_t)request.startOffset + request.numFrames >= replay.transferFrames;
+    bool due = matches && frame >= landing->frame;
+    if (matches && landing->kind == "load-failed") {
+        if (due) {
+            replay.nextLanding++;
+            ntStubFailLoad();
+        } else if (!lastChunk) {
+            ntStubPumpLoads();
+        }
+    } else if (matches && lastChunk) {
+        if (due) {
+            replay.nextLanding++;
+            ntStubPumpLoads();
+        }
+    } else {
+        ntStubPumpLoads();
+    }
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+static double nowSeconds() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char** argv) {
+    HostOptions opt;
+    if (!parseOptions(argc, argv, opt)) return 1;
+
+    // A replay takes its sample rate, block size and length from the log
+    Session session;
+    if (opt.replayPath) {
+        if (!readSession(opt.replayPath, session)) return 1;
+        if (session.sampleRate && session.sampleRate != NT_globals.sampleRate) {
+            fprintf(stderr, "drifters_host: %s was recorded at %uHz (set NT_SAMPLE_RATE)\n",
+                    opt.replayPath, session.sampleRate);
+            return 1;
+        }
+        if (!opt.blockSizeSet && session.blockSize) opt.blockSize = session.blockSize;
+        if (!opt.secondsSet) opt.seconds = (double)session.length / NT_globals.sampleRate;
+        if (session.lostEvents && !opt.quiet) {
+            fprintf(stderr, "drifters_host: %s lost events while recording; the replay will differ\n", opt.replayPath);
+        }
+    }
+    if (!checkBlockSize(opt.blockSize)) return 1;
+#ifdef DRIFTERS_RECORD
+    if (opt.recordPath) setenv("DRIFTERS_SESSION", opt.recordPath, 1);
+#endif
+
+    const _NT_factory* factory = ntStubFactory();
+    if (!factory) {
+        fprintf(stderr, "drifters_host: plugin has no factory\n");
+        return 1;
+    }
+
+    if (opt.samplesPath && ntStubSetSampleRoot(opt.samplesPath) == 0) {
+        fprintf(stderr, "drifters_host: no WAV files under %s\n", opt.samplesPath);
+        return 1;
+    }
+
+    // Specifications
+    std::vector<int32_t> specs = ntStubDefaultSpecifications();
+    for (size_t i = 0; i < session.specs.size(); i++) {
+        if (session.specs[i].first >= 0 && session.specs[i].first < (int)specs.size()) {
+            specs[session.specs[i].first] = session.specs[i].second;
+        }
+    }
+    for (size_t i = 0; i < opt.specs.size(); i++) {
+        int index, value;
+        if (!parseAssignment(opt.specs[i], ntStubFindSpecification, index, value)) return 1;
+        const _NT_specification& s = factory->specifications[index];
+        specs[index] = std::max(s.min, std::min(s.max, (int32_t)value));
+    }
+
+    // Memory and construction
+    NtStubInstance instance;
+    if (!ntStubCreate(instance, specs.data())) {
+        fprintf(stderr, "drifters_host: out of memory\n");
+        return 1;
+    }
+    _NT_algorithm* algorithm = instance.algorithm;
+    const int numParameters = instance.numParameters;
+    std::vector<int16_t>& values = instance.values;
+    auto findParameter = [&instance](const char* name) { return ntStubFindParameter(instance, name); };
+
+    if (opt.list) {
+        listNames(factory, algorithm, numParameters);
+        ntStubDestroy(instance);
+        return 0;
+    }
+
+    // Parameters start at their defaults (or the replayed session's first
+    // values); every one is announced, as when the module loads a preset
+    size_t nextParam = 0;
+    while (nextParam < session.params.size() && session.params[nextParam].frame == 0) {
+        const SessionEntry& e = session.params[nextParam++];
+        if (e.index >= 0 && e.index < numParameters) values[e.index] = (int16_t)e.value;
+    }
+    std::vector<bool> pinned(numParameters, false);
+    for (size_t i = 0; i < opt.params.size(); i++) {
+        int index, value;
+        if (!parseAssignment(opt.params[i], findParameter, index, value)) return 1;
+        const _NT_parameter& p = algorithm->parameters[index];
+        values[index] = (int16_t)std::max((int)p.min, std::min((int)p.max, value));
+        pinned[index] = true;
+    }
+    ntStubAnnounceParameters(instance);
+
+    // Scheduled changes
+    std::vector<ScheduledChange> changes;
+    for (size_t i = 0; i < opt.changes.size(); i++) {
+        const std::string& text = opt.changes[i];
+        size_t colon = text.find(':');
+        ScheduledChange change;
+        if (colon == std::string::npos ||
+            !parseAssignment(text.substr(colon + 1), findParameter, change.parameter, change.value)) {
+            fprintf(stderr, "drifters_host: --at wants SECONDS:NAME=VALUE, got '%s'\n", text.c_str());
+            return 1;
+        }
+        change.seconds = atof(text.c_str());
+        changes.push_back(change);
+    }
+    std::stable_sort(changes.begin(), changes.end(),
+                     [](const ScheduledChange& a, const ScheduledChange& b) { return a.seconds < b.seconds; });
+
+    // Live input
+    float* input = NULL;
+    uint32_t inputFrames = 0, inputChannels = 0, inputRate = 0;
+    if (opt.inputPath) {
+        input = ntStubLoadWav(opt.inputPath, inputFrames, inputChannels, inputRate);
+        if (!input || inputFrames == 0) {
+            fprintf(stderr, "drifters_host: can't read %s\n", opt.inputPath);
+            return 1;
+        }
+        if (inputRate != NT_globals.sampleRate && !opt.quiet) {
+            fprintf(stderr, "drifters_host: %s is %uHz, played at %uHz\n", opt.inputPath, inputRate, NT_globals.sampleRate);
+        }
+    }
+
+    // Render
+    const int blockSize = opt.blockSize;
+    const uint32_t sampleRate = NT_globals.sampleRate;
+    const uint64_t totalFrames = (uint64_t)(opt.seconds * sampleRate);
+    const uint64_t drawInterval = (opt.drawRate > 0) ? (uint64_t)(sampleRate / opt.drawRate) : 0;
+    std::vector<float> busses(kStubNumBusses * blockSize);
+    std::vector<float> output;
+    if (opt.outputPath) output.reserve(totalFrames * 2);
+
+    uint64_t frame = 0;
+    uint64_t inputPos = 0;
+    uint64_t nextDraw = 0;
+    size_t nextChange = 0;
+    size_t nextCv = 0;
+    std::vector<float> cvLevels(numParameters, 0.0f);
+    std::vector<int> cvInputs;    // CV input parameters the session logged
+    for (size_t i = 0; i < session.cv.size(); i++) {
+        int p = session.cv[i].index;
+        if (p >= 0 && p < numParameters && std::find(cvInputs.begin(), cvInputs.end(), p) == cvInputs.end()) {
+            cvInputs.push_back(p);
+        }
+    }
+    double sumSquares = 0;
+    float peak = 0;
+    bool nonFinite = false;
+    double stepSeconds = 0;
+
+    LoadReplay loadReplay = { 0, 0, 0 };
+
+    while (frame < totalFrames) {
+        if (opt.replayPath) {
+            replayLoads(session, loadReplay, frame);
+        } else {
+            ntStubPumpLoads();
+        }
+
+        while (nextChange < changes.size() && changes[nextChange].seconds * sampleRate <= frame) {
+            ntStubSetParameter(changes[nextChange].parameter, (int16_t)changes[nextChange].value);
+            nextChange++;
+        }
+
+        // Replayed changes land between blocks, where they were logged
+        while (nextParam < session.params.size() && session.params[nextParam].frame <= frame) {
+            const SessionEntry& e = session.params[nextParam++];
+            if (e.index >= 0 && e.index < numParameters && !pinned[e.index]) {
+                ntStubSetParameter(e.index, (int16_t)e.value);
+            }
+        }
+
+        std::fill(busses.begin(), busses.end(), 0.0f);
+        if (input) {
+            // Input L/R are the first two audio input parameters
+            int busL = ntStubAudioBus(instance, kNT_unitAudioInput, 0);
+            int busR = ntStubAudioBus(instance, kNT_unitAudioInput, 1);
+            for (int i = 0; i < blockSize; i++) {
+                const float* in = input + ((inputPos + i) % inputFrames) * inputChannels;
+                if (busL >= 0) busses[busL * blockSize + i] = in[0];
+                if (busR >= 0) busses[busR * blockSize + i] = in[inputChannels > 1 ? 1 : 0];
+            }
+            inputPos += blockSize;
+        }
+
+        // Replayed CV: each block's mean held, gate edges on their frame
+        if (opt.replayPath) {
+            for (int i = 0; i < blockSize; i++) {
+                while (nextCv < session.cv.size() && session.cv[nextCv].frame <= frame + i) {
+                    const SessionEntry& e = session.cv[nextCv++];
+                    if (e.index >= 0 && e.index < numParameters) cvLevels[e.index] = e.level;
+                }
+                for (size_t c = 0; c < cvInputs.size(); c++) {
+                    int p = cvInputs[c];
+                    if (values[p] > 0) busses[(values[p] - 1) * blockSize + i] = cvLevels[p];
+                }
+            }
+        }
+
+        double start = nowSeconds();
+        factory->step(algorithm, busses.data(), blockSize / 4);
+        stepSeconds += nowSeconds() - start;
+
+        if (drawInterval && frame >= nextDraw && factory->draw) {
+            ntStubClearScreen();
+            factory->draw(algorithm);
+            nextDraw += drawInterval;
+        }
+
+        // Out L/R are the first two audio output parameters
+        int outL = ntStubAudioBus(instance, kNT_unitAudioOutput, 0);
+        int outR = ntStubAudioBus(instance, kNT_unitAudioOutput, 1);
+        for (int i = 0; i < blockSize && frame + i < totalFrames; i++) {
+            float l = (outL >= 0) ? busses[outL * blockSize + i] : 0;
+            float r = (outR >= 0) ? busses[outR * blockSize + i] : 0;
+            if (!std::isfinite(l) || !std::isfinite(r)) nonFinite = true;
+            sumSquares += 0.5 * ((double)l * l + (double)r * r);
+            peak = std::max(peak, std::max(fabsf(l), fabsf(r)));
+            if (opt.outputPath) {
+                output.push_back(l);
+                output.push_back(r);
+            }
+        }
+        frame += blockSize;
+    }
+
+    if (opt.outputPath &&
+        !ntStubWriteWav(opt.outputPath, output.data(), (uint32_t)(output.size() / 2), 2, sampleRate)) {
+        fprintf(stderr, "drifters_host: can't write %s\n", opt.outputPath);
+        return 1;
+    }
+
+    if (!opt.quiet) {
+        double rendered = (double)totalFrames / sampleRate;
+        printf("rendered %.2fs at %uHz in blocks of %d: step() %.3fs (%.1fx realtime, %.1f ns/frame)\n",
+               rendered, sampleRate, blockSize, stepSeconds,
+               stepSeconds > 0 ? rendered / stepSeconds : 0.0,
+               totalFrames ? stepSeconds * 1e9 / totalFrames : 0.0);
+        printf("output rms %.4f peak %.4f%s\n",
+               totalFrames ? sqrt(sumSquares / totalFrames) : 0.0, peak, nonFinite ? " NON-FINITE" : "");
+    }
+
+#ifdef DRIFTERS_RECORD
+    // One more draw() writes out the end of the session log
+    if (factory->draw) {
+        ntStubClearScreen();
+        factory->draw(algorithm);
+    }
+#endif
+    if (opt.replayPath && !opt.quiet) {
+        printf("replayed %s: %zu parameter changes, %zu CV events, %d loads logged\n", opt.replayPath,
+               session.params.size(), session.cv.size(), session.loads);
+    }
+    if (opt.screen) printf("%s", ntStubScreenText().c_str());
+
+    delete[] input;
+    ntStubDestroy(instance);
+    return nonFinite ? 2 : 0;
+}
@@ -0,0 +1,38 @@
+/*
+ * Drifters - headless host harness
+ *
+ * Synthetic test material, built in memory so benchmarks and golden tests
+ * run the same audio everywhere without any files.
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <vector>
+
+// Deterministic noise (-1..1)
+static inline float materialNoise(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return (float)(int32_t)state * (1.0f / 2147483648.0f);
+}
+
+// Interleaved stereo chord with noise bursts: pitched material for the
+// analysis to find, transients for the onset map
+static inline std::vector<float> makeMaterial(uint32_t numFrames, uint32_t sampleRate, uint32_t seed) {
+    static const float partials[] = { 110.0f, 164.8f, 220.0f, 277.2f, 329.6f };
+    std::vector<float> frames(numFrames * 2);
+    uint32_t state = seed;
+    for (uint32_t i = 0; i < numFrames; i++) {
+        float t = (float)i / sampleRate;
+        float chord = 0;
+        for (size_t p = 0; p < sizeof(partials) / sizeof(partials[0]); p++) {
+            chord += sinf(2.0f * (float)M_PI * partials[p] * t + (float)p) / (p + 1);
+        }
+        float burstPhase = fmodf(t, 0.75f);
+        float burst = (burstPhase < 0.08f) ? (1.0f - burstPhase / 0.08f) : 0.0f;
+        frames[2 * i] = 0.3f * chord + 0.4f * burst * materialNoise(state);
+        frames[2 * i + 1] = 0.3f * chord * cosf(0.5f * t) + 0.4f * burst * materialNoise(state);
+    }
+    return frames;
+}
@@ -0,0 +1,590 @@
+/*
+ * Drifters - headless host harness
+ *
+ * A stub of the distingNT API for running the plugin on a desktop: globals,
+ * parameter calls, no-op drawing and WAV "SD card" access backed by local
+ * files. Just enough of the firmware for drifters.cpp - not a general
+ * emulator.
+ *
+ * Define NT_STUB_BARE_METAL to build for an embedded C library (newlib, as
+ * in the Cortex-M7 instruction-count benchmark): there is no directory
+ * scanning, so only in-memory samples from ntStubAddSample() are available.
+ */
+
+#include "nt_stub.h"
+
+#include <distingnt/wav.h>
+#ifdef NT_STUB_BARE_METAL
+#include <malloc.h>
+#else
+#include <dirent.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+// ============================================================================
+// GLOBALS
+// ============================================================================
+
+static constexpr uint32_t kStubMaxFramesPerStep = 256;
+static constexpr uint32_t kStubWorkBufferBytes = 65536;
+
+static float stubWorkBuffer[kStubWorkBufferBytes / sizeof(float)];
+
+// NT_globals is const, so the sample rate is fixed before main() runs:
+// NT_SAMPLE_RATE in the environment, 48kHz by default
+static uint32_t stubSampleRate() {
+    const char* env = getenv("NT_SAMPLE_RATE");
+    int rate = env ? atoi(env) : 0;
+    return (rate >= 8000 && rate <= 192000) ? (uint32_t)rate : 48000;
+}
+
+const _NT_globals NT_globals = {
+    stubSampleRate(),
+    kStubMaxFramesPerStep,
+    stubWorkBuffer,
+    kStubWorkBufferBytes,
+};
+
+// ============================================================================
+// PARAMETERS
+// ============================================================================
+
+static const _NT_factory* stubFactory;
+static _NT_algorithm* stubAlgorithm;
+static int16_t* stubValues;
+static int stubNumParameters;
+
+void ntStubAttach(const _NT_factory* factory, _NT_algorithm* algorithm, int16_t* values, int numParameters) {
+    stubFactory = factory;
+    stubAlgorithm = algorithm;
+    stubValues = values;
+    stubNumParameters = numParameters;
+}
+
+void ntStubSetParameter(int parameter, int16_t value) {
+    if (!stubAlgorithm || parameter < 0 || parameter >= stubNumParameters) return;
+    const _NT_parameter& def = stubAlgorithm->parameters[parameter];
+    if (value < def.min) value = def.min;
+    if (value > def.max) value = def.max;
+    stubValues[parameter] = value;
+    if (stubFactory->parameterChanged) {
+        stubFactory->parameterChanged(stubAlgorithm, parameter);
+    }
+}
+
+int32_t NT_algorithmIndex(const _NT_algorithm* algorithm) {
+    return 0;
+}
+
+uint32_t NT_parameterOffset(void) {
+    return 0;
+}
+
+void NT_setParameterFromUi(uint32_t algorithmIndex, uint32_t parameter, int16_t value) {
+    ntStubSetParameter((int)(parameter - NT_parameterOffset()), value);
+}
+
+void NT_setParameterFromAudio(uint32_t algorithmIndex, uint32_t parameter, int16_t value) {
+    ntStubSetParameter((int)(parameter - NT_parameterOffset()), value);
+}
+
+void NT_updateParameterDefinition(uint32_t algorithmIndex, uint32_t parameter) {
+}
+
+void NT_setParameterGrayedOut(uint32_t algorithmIndex, uint32_t parameter, bool gray) {
+}
+
+// ============================================================================
+// INSTANCES
+// ============================================================================
+
+static void dropPendingRead();
+
+const _NT_factory* ntStubFactory() {
+    return (const _NT_factory*)pluginEntry(kNT_selector_factoryInfo, 0);
+}
+
+std::vector<int32_t> ntStubDefaultSpecifications() {
+    const _NT_factory* factory = ntStubFactory();
+    std::vector<int32_t> specs(factory->numSpecifications);
+    for (uint32_t i = 0; i < factory->numSpecifications; i++) specs[i] = factory->specifications[i].def;
+    return specs;
+}
+
+// Zeroed and 16-byte aligned, as the module's memory regions are
+static uint8_t* allocateRegion(uint32_t bytes) {
+#ifdef NT_STUB_BARE_METAL
+    void* p = memalign(16, bytes ? bytes : 16);
+    if (!p) return NULL;
+#else
+    void* p = NULL;
+    if (posix_memalign(&p, 16, bytes ? bytes : 16)) return NULL;
+#endif
+    memset(p, 0, bytes);
+    return (uint8_t*)p;
+}
+
+bool ntStubCreate(NtStubInstance& instance, const int32_t* specifications) {
+    instance.factory = ntStubFactory();
+    instance.algorithm = NULL;
+    if (!instance.factory) return false;
+
+    _NT_algorithmRequirements req;
+    memset(&req, 0, sizeof(req));
+    instance.factory->calculateRequirements(req, specifications);
+    instance.memory.sram = allocateRegion(req.sram);
+    instance.memory.dram = allocateRegion(req.dram);
+    instance.memory.dtc = allocateRegion(req.dtc);
+    instance.memory.itc = allocateRegion(req.itc);
+    if (!instance.memory.sram || !instance.memory.dram || !instance.memory.dtc || !instance.memory.itc) {
+        ntStubDestroy(instance);
+        return false;
+    }
+
+    instance.algorithm = instance.factory->construct(instance.memory, req, specifications);
+    instance.numParameters = (int)req.numParameters;
+    instance.values.resize(instance.numParameters);
+    for (int i = 0; i < instance.numParameters; i++) {
+        instance.values[i] = instance.algorithm->parameters[i].def;
+    }
+    instance.algorithm->v = instance.values.data();
+    ntStubAttach(instance.factory, instance.algorithm, instance.values.data(), instance.numParameters);
+    return true;
+}
+
+void ntStubAnnounceParameters(NtStubInstance& instance) {
+    if (!instance.factory->parameterChanged) return;
+    for (int i = 0; i < instance.numParameters; i++) {
+        instance.factory->parameterChanged(instance.algorithm, i);
+    }
+}
+
+void ntStubDestroy(NtStubInstance& instance) {
+    // A read still in flight would call back into freed memory
+    dropPendingRead();
+    if (stubAlgorithm == instance.algorithm) stubAlgorithm = NULL;
+    free(instance.memory.sram);
+    free(instance.memory.dram);
+    free(instance.memory.dtc);
+    free(instance.memory.itc);
+    memset(&instance.memory, 0, sizeof(instance.memory));
+    instance.algorithm = NULL;
+}
+
+static std::string normaliseName(const char* name) {
+    std::string s = name;
+    for (size_t i = 0; i < s.size(); i++) {
+        s[i] = (s[i] == '_') ? ' ' : (char)tolower((unsigned char)s[i]);
+    }
+    return s;
+}
+
+template <typename T>
+static int findByName(const T* entries, int count, const char* name) {
+    char* end;
+    long index = strtol(name, &end, 10);
+    if (*end == 0 && *name) return (index >= 0 && index < count) ? (int)index : -1;
+    std::string wanted = normaliseName(name);
+    for (int i = 0; i < count; i++) {
+        if (normaliseName(entries[i].name) == wanted) return i;
+    }
+    return -1;
+}
+
+int ntStubFindParameter(const NtStubInstance& instance, const char* name) {
+    return findByName(instance.algorithm->parameters, instance.numParameters, name);
+}
+
+int ntStubFindSpecification(const char* name) {
+    const _NT_factory* factory = ntStubFactory();
+    return findByName(factory->specifications, (int)factory->numSpecifications, name);
+}
+
+int ntStubAudioBus(const NtStubInstance& instance, int unit, int nth) {
+    for (int i = 0; i < instance.numParameters; i++) {
+        if (instance.algorithm->parameters[i].unit != unit) continue;
+        if (nth-- == 0) return instance.values[i] - 1;
+    }
+    return -1;
+}
+
+// ============================================================================
+// DRAWING (headless - shapes are dropped, text is kept for ntStubScreenText)
+// ============================================================================
+
+struct StubText {
+    int x;
+    int y;
+    std::string text;
+};
+
+static std::vector<StubText> stubScreen;
+
+void ntStubClearScreen() {
+    stubScreen.clear();
+}
+
+std::string ntStubScreenText() {
+    std::vector<StubText> items = stubScreen;
+    std::stable_sort(items.begin(), items.end(), [](const StubText& a, const StubText& b) {
+        return (a.y != b.y) ? a.y < b.y : a.x < b.x;
+    });
+    std::string screen;
+    for (size_t i = 0; i < items.size(); i++) {
+        if (i > 0) screen += (items[i].y != items[i - 1].y) ? "\n" : " ";
+        screen += items[i].text;
+    }
+    if (!screen.empty()) screen += "\n";
+    return screen;
+}
+
+void NT_drawText(int x, int y, const char* str, int colour, _NT_textAlignment align, _NT_textSize size) {
+    StubText item;
+    item.x = x;
+    item.y = y;
+    item.text = str;
+    stubScreen.push_back(item);
+}
+
+void NT_drawShapeI(_NT_shape shape, int x0, int y0, int x1, int y1, int colour) {
+}
+
+void NT_drawShapeF(_NT_shape shape, float x0, float y0, float x1, float y1, float colour) {
+}
+
+int NT_intToString(char* buffer, int32_t value) {
+    return sprintf(buffer, "%d", (int)value);
+}
+
+int NT_floatToString(char* buffer, float value, int decimalPlaces) {
+    return sprintf(buffer, "%.*f", decimalPlaces, value);
+}
+
+// ============================================================================
+// WAV FILES
+// ============================================================================
+
+static uint32_t readLE(const uint8_t* p, int bytes) {
+    uint32_t v = 0;
+    for (int i = bytes - 1; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static void writeLE(FILE* f, uint32_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) fputc((v >> (8 * i)) & 0xFF, f);
+}
+
+float* ntStubLoadWav(const char* path, uint32_t& numFrames, uint32_t& numChannels, uint32_t& sampleRate) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+    std::vector<uint8_t> file;
+    uint8_t chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) file.insert(file.end(), chunk, chunk + n);
+    fclose(f);
+
+    if (file.size() < 12 || memcmp(&file[0], "RIFF", 4) || memcmp(&file[8], "WAVE", 4)) return NULL;
+
+    uint32_t format = 0, bits = 0;
+    numChannels = 0;
+    const uint8_t* data = NULL;
+    uint32_t dataBytes = 0;
+    size_t pos = 12;
+    while (pos + 8 <= file.size()) {
+        const uint8_t* id = &file[pos];
+        uint32_t size = readLE(&file[pos + 4], 4);
+        const uint8_t* body = &file[pos + 8];
+        size_t available = file.size() - (pos + 8);
+        if (size > available) size = (uint32_t)available;
+        if (!memcmp(id, "fmt ", 4) && size >= 16) {
+            format = readLE(body, 2);
+            numChannels = readLE(body + 2, 2);
+            sampleRate = readLE(body + 4, 4);
+            bits = readLE(body + 14, 2);
+            if (format == 0xFFFE && size >= 26) format = readLE(body + 24, 2);  // Extensible: sub-format
+        } else if (!memcmp(id, "data", 4)) {
+            data = body;
+            dataBytes = size;
+        }
+        pos += 8 + size + (size & 1);
+    }
+
+    bool isFloat = (format == 3 && bits == 32);
+    bool isPcm = (format == 1 && (bits == 8 || bits == 16 || bits == 24 || bits == 32));
+    if (!data || numChannels == 0 || (!isFloat && !isPcm)) return NULL;
+
+    uint32_t bytesPerSample = bits / 8;
+    numFrames = dataBytes / (bytesPerSample * numChannels);
+    float* frames = new float[(size_t)numFrames * numChannels];
+    for (size_t i = 0; i < (size_t)numFrames * numChannels; i++) {
+        const uint8_t* p = data + i * bytesPerSample;
+        float x;
+        if (isFloat) {
+            uint32_t raw = readLE(p, 4);
+            memcpy(&x, &raw, sizeof(x));
+        } else if (bits == 8) {
+            x = (p[0] - 128) / 128.0f;
+        } else {
+            // Sign-extend from the top byte
+            int32_t v = (int32_t)(readLE(p, bytesPerSample) << (32 - bits));
+            x = v / 2147483648.0f;
+        }
+        frames[i] = x;
+    }
+    return frames;
+}
+
+bool ntStubWriteWav(const char* path, const float* frames, uint32_t numFrames, uint32_t numChannels, uint32_t sampleRate) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    uint32_t dataBytes = numFrames * numChannels * 4;
+    fwrite("RIFF", 1, 4, f);
+    writeLE(f, 36 + dataBytes, 4);
+    fwrite("WAVEfmt ", 1, 8, f);
+    writeLE(f, 16, 4);
+    writeLE(f, 3, 2);                              // IEEE float
+    writeLE(f, numChannels, 2);
+    writeLE(f, sampleRate, 4);
+    writeLE(f, sampleRate * numChannels * 4, 4);
+    writeLE(f, numChannels * 4, 2);
+    writeLE(f, 32, 2);
+    fwrite("data", 1, 4, f);
+    writeLE(f, dataBytes, 4);
+    for (uint32_t i = 0; i < numFrames * numChannels; i++) {
+        uint32_t raw;
+        memcpy(&raw, &frames[i], sizeof(raw));
+        writeLE(f, raw, 4);
+    }
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+// ============================================================================
+// SD CARD
+// ============================================================================
+
+// One sample file, decoded on first use
+struct StubSample {
+    std::string path;
+    std::string name;
+    std::vector<float> frames;     // Interleaved
+    uint32_t numFrames;
+    uint32_t numChannels;
+    uint32_t sampleRate;
+    bool loaded;
+    bool valid;
+};
+
+struct StubFolder {
+    std::string name;
+    std::vector<StubSample> samples;
+};
+
+static std::vector<StubFolder> stubFolders;
+
+// Outstanding asynchronous read (the module handles one at a time)
+static _NT_wavRequest stubPendingRead;
+static bool stubReadPending;
+
+static std::vector<std::string> listDirectory(const std::string& path, bool wantDirectories) {
+    std::vector<std::string> names;
+#ifndef NT_STUB_BARE_METAL
+    DIR* dir = opendir(path.c_str());
+    if (!dir) return names;
+    while (struct dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.empty() || name[0] == '.') continue;
+        std::string full = path + "/" + name;
+        DIR* sub = opendir(full.c_str());
+        bool isDirectory = (sub != NULL);
+        if (sub) closedir(sub);
+        if (wantDirectories) {
+            if (isDirectory) names.push_back(name);
+        } else if (!isDirectory && name.size() > 4) {
+            std::string ext = name.substr(name.size() - 4);
+            std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+            if (ext == ".wav") names.push_back(name);
+        }
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+#endif
+    return names;
+}
+
+static void addFolder(const std::string& path, const std::string& name) {
+    StubFolder folder;
+    folder.name = name;
+    std::vector<std::string> files = listDirectory(path, false);
+    for (size_t i = 0; i < files.size(); i++) {
+        StubSample sample;
+        sample.path = path + "/" + files[i];
+        sample.name = files[i];
+        sample.numFrames = 0;
+        sample.numChannels = 1;
+        sample.sampleRate = 48000;
+        sample.loaded = false;
+        sample.valid = false;
+        folder.samples.push_back(sample);
+    }
+    if (!folder.samples.empty()) stubFolders.push_back(folder);
+}
+
+int ntStubSetSampleRoot(const char* path) {
+    stubFolders.clear();
+    std::string root = path;
+    std::vector<std::string> subdirs = listDirectory(root, true);
+    for (size_t i = 0; i < subdirs.size(); i++) {
+        addFolder(root + "/" + subdirs[i], subdirs[i]);
+    }
+    if (stubFolders.empty()) {
+        addFolder(root, root);
+    }
+    return (int)stubFolders.size();
+}
+
+void ntStubAddSample(const char* folderName, const char* name, const float* frames,
+                     uint32_t numFrames, uint32_t numChannels, uint32_t sampleRate) {
+    size_t f = 0;
+    while (f < stubFolders.size() && stubFolders[f].name != folderName) f++;
+    if (f == stubFolders.size()) {
+        StubFolder folder;
+        folder.name = folderName;
+        stubFolders.push_back(folder);
+    }
+    StubSample sample;
+    sample.name = name;
+    sample.frames.assign(frames, frames + (size_t)numFrames * numChannels);
+    sample.numFrames = numFrames;
+    sample.numChannels = numChannels;
+    sample.sampleRate = sampleRate;
+    sample.loaded = true;
+    sample.valid = true;
+    stubFolders[f].samples.push_back(sample);
+}
+
+static StubSample* findSample(uint32_t folder, uint32_t sample) {
+    if (folder >= stubFolders.size() || sample >= stubFolders[folder].samples.size()) return NULL;
+    StubSample& s = stubFolders[folder].samples[sample];
+    if (!s.loaded) {
+        s.loaded = true;
+        float* frames = ntStubLoadWav(s.path.c_str(), s.numFrames, s.numChannels, s.sampleRate);
+        s.valid = (frames != NULL);
+        if (frames) {
+            s.frames.assign(frames, frames + (size_t)s.numFrames * s.numChannels);
+            delete[] frames;
+        }
+        if (!s.valid) fprintf(stderr, "nt_stub: can't read %s\n", s.path.c_str());
+    }
+    return s.valid ? &s : NULL;
+}
+
+bool NT_isSdCardMounted(void) {
+    return !stubFolders.empty();
+}
+
+uint32_t NT_getNumSampleFolders(void) {
+    return (uint32_t)stubFolders.size();
+}
+
+void NT_getSampleFolderInfo(uint32_t folder, _NT_wavFolderInfo& info) {
+    if (folder < stubFolders.size()) {
+        info.name = stubFolders[folder].name.c_str();
+        info.numSampleFiles = (uint32_t)stubFolders[folder].samples.size();
+    } else {
+        info.name = "";
+        info.numSampleFiles = 0;
+    }
+}
+
+void NT_getSampleFileInfo(uint32_t folder, uint32_t sample, _NT_wavInfo& info) {
+    StubSample* s = findSample(folder, sample);
+    info.name = s ? s->name.c_str() : "";
+    info.numFrames = s ? s->numFrames : 0;
+    info.sampleRate = s ? s->sampleRate : 48000;
+    info.channels = (s && s->numChannels > 1) ? kNT_WavStereo : kNT_WavMono;
+    info.bits = kNT_WavBits16;
+}
+
+bool NT_readSampleFrames(const _NT_wavRequest& request) {
+    if (stubReadPending) return false;
+    stubPendingRead = request;
+    stubReadPending = true;
+    return true;
+}
+
+static void dropPendingRead() {
+    stubReadPending = false;
+}
+
+// Store one converted sample in the requested format
+static void storeSample(void* dst, size_t index, _NT_wavBits bits, float x) {
+    if (x > 1.0f) x = 1.0f;
+    if (x < -1.0f) x = -1.0f;
+    switch (bits) {
+        case kNT_WavBits8:
+            ((int8_t*)dst)[index] = (int8_t)(x * 127.0f);
+            break;
+        case kNT_WavBits16:
+            ((int16_t*)dst)[index] = (int16_t)(x * 32767.0f);
+            break;
+        case kNT_WavBits24: {
+            int32_t v = (int32_t)(x * 8388607.0f);
+            uint8_t* p = (uint8_t*)dst + index * 3;
+            p[0] = v & 0xFF;
+            p[1] = (v >> 8) & 0xFF;
+            p[2] = (v >> 16) & 0xFF;
+            break;
+        }
+        default:
+            ((float*)dst)[index] = x;  // 32-bit float
+            break;
+    }
+}
+
+void ntStubPumpLoads() {
+    if (!stubReadPending) return;
+    stubReadPending = false;
+    _NT_wavRequest request = stubPendingRead;
+
+    StubSample* s = findSample(request.folder, request.sample);
+    if (s) {
+        bool stereo = (request.channels == kNT_WavStereo);
+        for (uint32_t i = 0; i < request.numFrames; i++) {
+            uint32_t frame = request.startOffset + i;
+            float left = 0, right = 0;
+            if (frame < s->numFrames) {
+                const float* in = &s->frames[(size_t)frame * s->numChannels];
+                left = in[0];
+                right = (s->numChannels > 1) ? in[1] : in[0];
+            }
+            if (stereo) {
+                storeSample(request.dst, 2 * i, request.bits, left);
+                storeSample(request.dst, 2 * i + 1, request.bits, right);
+            } else {
+                storeSample(request.dst, i, request.bits, 0.5f * (left + right));
+            }
+        }
+    }
+    if (request.callback) request.callback(request.callbackData, s != NULL);
+}
+
+bool ntStubPendingLoad(_NT_wavRequest& request) {
+    if (!stubReadPending) return false;
+    request = stubPendingRead;
+    return true;
+}
+
+void ntStubFailLoad() {
+    if (!stubReadPending) return;
+    stubReadPending = false;
+    _NT_wavRequest request = stubPendingRead;
+    if (request.callback) request.callback(request.callbackData, false);
+}
@@ -0,0 +1,91 @@
+/*
+ * Drifters - headless host harness
+ *
+ * Host side of the stub distingNT API in nt_stub.cpp. The plugin links
+ * against the stub exactly as it would against the module firmware; these
+ * calls let a command-line host drive it.
+ */
+
+#pragma once
+
+#include <distingnt/api.h>
+#include <distingnt/wav.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Number of busses the stub provides (as on the distingNT)
+static constexpr int kStubNumBusses = 28;
+
+// Point the "SD card" at a directory of samples
+// Each subdirectory (sorted by name) is a sample folder of *.wav files;
+// a directory holding WAVs directly is treated as a single folder.
+// Returns the number of folders found (0 = card not mounted).
+int ntStubSetSampleRoot(const char* path);
+
+// Add an in-memory sample (interleaved frames) to a folder, creating it
+// after any existing folders if needed
+void ntStubAddSample(const char* folderName, const char* name, const float* frames,
+                     uint32_t numFrames, uint32_t numChannels, uint32_t sampleRate);
+
+// A constructed plugin and the memory it lives in
+struct NtStubInstance {
+    const _NT_factory* factory;
+    _NT_algorithm* algorithm;
+    _NT_algorithmMemoryPtrs memory;
+    std::vector<int16_t> values;
+    int numParameters;
+};
+
+// The plugin's factory (NULL if it has none)
+const _NT_factory* ntStubFactory();
+
+// Specification defaults, ready to be overridden
+std::vector<int32_t> ntStubDefaultSpecifications();
+
+// Allocate and construct an instance with its parameters at their defaults,
+// and attach the stub to it. Set any values, then announce them.
+bool ntStubCreate(NtStubInstance& instance, const int32_t* specifications);
+
+// Call parameterChanged for every parameter, as the module does on preset load
+void ntStubAnnounceParameters(NtStubInstance& instance);
+
+void ntStubDestroy(NtStubInstance& instance);
+
+// Connect the stub to a constructed algorithm so parameter calls reach it
+void ntStubAttach(const _NT_factory* factory, _NT_algorithm* algorithm, int16_t* values, int numParameters);
+
+// Parameter or specification index from a name (case ignored, '_' for a
+// space) or a plain number; -1 if there is none
+int ntStubFindParameter(const NtStubInstance& instance, const char* name);
+int ntStubFindSpecification(const char* name);
+
+// Zero-based bus of the nth parameter with an audio input/output unit
+// (kNT_unitAudioInput or kNT_unitAudioOutput); -1 when unassigned
+int ntStubAudioBus(const NtStubInstance& instance, int unit, int nth);
+
+// Set a parameter the way the module does (value stored, then parameterChanged)
+void ntStubSetParameter(int parameter, int16_t value);
+
+// Complete the outstanding sample read, if any, and fire its callback
+// The module reads asynchronously; hosts call this between steps.
+void ntStubPumpLoads();
+
+// The outstanding sample read, if any, for hosts that decide when reads
+// land themselves (session replay) rather than pumping every step
+bool ntStubPendingLoad(_NT_wavRequest& request);
+
+// Fail the outstanding read: nothing is read and its callback reports an error
+void ntStubFailLoad();
+
+// Text drawn since the last clear, one line per y position in x order
+// (shapes aren't kept). Clear before each draw() to see a single frame.
+void ntStubClearScreen();
+std::string ntStubScreenText();
+
+// Load a whole WAV file as interleaved float frames (NULL on failure)
+// The caller frees the returned buffer with delete[].
+float* ntStubLoadWav(const char* path, uint32_t& numFrames, uint32_t& numChannels, uint32_t& sampleRate);
+
+// Write interleaved float frames as a 32-bit float WAV
+bool ntStubWriteWav(const char* path, const float* frames, uint32_t numFrames, uint32_t numChannels, uint32_t sampleRate);
@@ -0,0 +1,529 @@
+/*
+ * Drifters - worst-case stress runs
+ *
+ * Drives the plugin with adversarial automation - audio-rate CV on every
+ * input, Storm gate spam, kHz clocks, Live Mode and Freeze flipping every
+ * few blocks, sample switches faster than the cache can settle and random
+ * jumps of every performance parameter - and records what each block of
+ * step() cost and whether any output went NaN or infinite.
+ *
+ *   drifters_stress -o stress.json --fail-over 50
+ *
+ * Real-time audio fails on its worst block, not its average one, so the
+ * report is a distribution: percentiles, the maximum and where in the run
+ * it fell, and the maximum as a share of the block's real-time budget.
+ * Every run is seeded (--seed), so a bad block can be found again.
+ */
+
+#include "nt_stub.h"
+#include "material.h"
+
+#include <math.h>
+#include <cmath>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+// ============================================================================
+// SCENARIOS
+// ============================================================================
+
+static constexpr uint32_t kStressSampleRate = 48000;
+static constexpr double kWarmupSeconds = 1.0;
+static constexpr double kDrawRate = 30.0;
+
+// Each attack is one kind of abuse; a scenario combines some of them
+enum Attack {
+    kAttackCv      = 1 << 0,    // Audio-rate noise, squares and extremes on the CV inputs
+    kAttackStorm   = 1 << 1,    // Storm gate toggled every block, sometimes every frame
+    kAttackClock   = 1 << 2,    // Clock swept from 1Hz to 12kHz, with jumps
+    kAttackLive    = 1 << 3,    // Live Mode, Freeze and mono/stereo input flipped every few blocks
+    kAttackSamples = 1 << 4,    // Folder and sample switched every few blocks
+    kAttackParams  = 1 << 5,    // Performance parameters jumped to random values and extremes
+
+    kAttackAll = (1 << 6) - 1
+};
+
+struct StressScenario {
+    const char* name;
+    int attacks;
+    std::vector<const char*> params;    // NAME=VALUE, set before the run
+    bool noiseInput;                    // Live input is noise, which no pitch search settles on early
+    double budgetPercent;               // Fail if the p99.9 block takes more of its real-time duration (0 = no limit)
+};
+
+static std::vector<StressScenario> buildScenarios() {
+    std::vector<StressScenario> s;
+    s.push_back({ "cv", kAttackCv, { "Density=100" } });
+    s.push_back({ "storm", kAttackStorm, { "Density=75" } });
+    s.push_back({ "clock", kAttackClock, { "Density=100", "Deviation=0" } });
+    s.push_back({ "live-freeze", kAttackLive, { "Density=100", "Spectrum=60", "Scale=1" } });
+    s.push_back({ "live-scale", kAttackCv | kAttackStorm, { "Live Mode=1", "Density=100", "Scale=1" }, true, 15.0 });
+    s.push_back({ "samples", kAttackSamples, { "Density=100", "Scale=1" } });
+    s.push_back({ "params", kAttackParams, {} });
+    s.push_back({ "everything", kAttackAll, {} });
+    s.push_back({ "everything-hq", kAttackAll, { "Quality=2", "Density=100", "Spectrum=100" } });
+    return s;
+}
+
+// Performance parameters the params attack jumps around (routing, sample
+// choice and Live Mode have attacks of their own)
+static const char* const performanceParams[] = {
+    "Mix", "Min delay", "Anchor", "Wander", "Gravity", "Drift", "Seek", "Density",
+    "Deviation", "Pitch", "Scatter", "Scale", "Spectrum", "Tilt", "Shape", "Entropy",
+    "Quality", "Telemetry",
+};
+
+static const int kNumPerformanceParams = sizeof(performanceParams) / sizeof(performanceParams[0]);
+
+// CV inputs and the busses they're patched to for every run (1-based);
+// the outputs get busses of their own so all of them can be checked
+static const char* const cvInputs[] = { "Anchor CV", "Pitch CV", "Drift CV", "Entropy CV" };
+static const int kNumCvInputs = sizeof(cvInputs) / sizeof(cvInputs[0]);
+static const int kFirstCvBus = 3;
+static const int kStormBus = 7;
+static const int kClockBus = 8;
+
+static const char* const outputs[] = { "Out L", "Out R", "Position", "Pulse", "Telemetry out" };
+static const int kNumOutputs = sizeof(outputs) / sizeof(outputs[0]);
+static const int kFirstOutputBus = 13;
+
+// ============================================================================
+// ADVERSARY
+// ============================================================================
+
+struct Random {
+    uint32_t state;
+
+    uint32_t next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+    float uniform() { return (next() >> 8) * (1.0f / 16777216.0f); }    // 0..1
+    float bipolar() { return uniform() * 2.0f - 1.0f; }
+    int below(int n) { return (int)(next() % (uint32_t)n); }
+};
+
+// One CV input's current abuse, changed every few milliseconds
+enum CvShape { kCvNoise, kCvSquare, kCvSaw, kCvExtreme, kNumCvShapes };
+
+struct CvVoice {
+    CvShape shape;
+    float phase;
+    float increment;      // Cycles per frame
+    float level;
+    int framesLeft;
+};
+
+struct Adversary {
+    Random random;
+    int attacks;
+    CvVoice cv[kNumCvInputs];
+    bool storm;
+    float clockPhase;
+    float clockHz;
+    int liveCountdown;
+    int sampleCountdown;
+    int liveMode, freeze, inputR;
+};
+
+static void cvFrame(Adversary& a, CvVoice& v, float& out) {
+    if (v.framesLeft-- <= 0) {
+        v.shape = (CvShape)a.random.below(kNumCvShapes);
+        v.increment = 20.0f * powf(500.0f, a.random.uniform()) / kStressSampleRate;    // 20Hz-10kHz
+        v.level = a.random.bipolar() * 10.0f;
+        v.framesLeft = 48 + a.random.below(4800);
+    }
+    v.phase += v.increment;
+    v.phase -= floorf(v.phase);
+    switch (v.shape) {
+        case kCvNoise: out = a.random.bipolar() * 10.0f; break;
+        case kCvSquare: out = (v.phase < 0.5f) ? v.level : -v.level; break;
+        case kCvSaw: out = (v.phase * 2.0f - 1.0f) * v.level; break;
+        default: out = v.level; break;
+    }
+}
+
+// Parameter changes made before a block, as the module's UI or MIDI would
+static void changeParameters(Adversary& a, const NtStubInstance& instance, const int* performance,
+                             int folderParam, int sampleParam, int liveParam, int freezeParam, int inputRParam) {
+    if ((a.attacks & kAttackLive) && --a.liveCountdown <= 0) {
+        switch (a.random.below(3)) {
+            case 0: ntStubSetParameter(liveParam, (int16_t)(a.liveMode ^= 1)); break;
+            case 1: ntStubSetParameter(freezeParam, (int16_t)(a.freeze ^= 1)); break;
+            default: ntStubSetParameter(inputRParam, (int16_t)(a.inputR = a.inputR ? 0 : 2)); break;
+        }
+        a.liveCountdown = 1 + a.random.below(16);
+    }
+    if ((a.attacks & kAttackSamples) && --a.sampleCountdown <= 0) {
+        if (a.random.below(4) == 0) ntStubSetParameter(folderParam, (int16_t)a.random.below(2));
+        ntStubSetParameter(sampleParam, (int16_t)a.random.below(6));
+        a.sampleCountdown = 1 + a.random.below(32);
+    }
+    if (a.attacks & kAttackParams) {
+        for (int n = a.random.below(4); n > 0; n--) {
+            int index = performance[a.random.below(kNumPerformanceParams)];
+            const _NT_parameter& p = instance.algorithm->parameters[index];
+            int value;
+            switch (a.random.below(3)) {
+                case 0: value = p.min; break;
+                case 1: value = p.max; break;
+                default: value = p.min + a.random.below(p.max - p.min + 1); break;
+            }
+            ntStubSetParameter(index, (int16_t)value);
+        }
+    }
+}
+
+// Fill the CV busses for one block
+static void fillCv(Adversary& a, float* busses, int blockSize) {
+    if (a.attacks & kAttackCv) {
+        for (int c = 0; c < kNumCvInputs; c++) {
+            float* bus = busses + (kFirstCvBus - 1 + c) * blockSize;
+            for (int i = 0; i < blockSize; i++) cvFrame(a, a.cv[c], bus[i]);
+        }
+    }
+    if (a.attacks & kAttackStorm) {
+        float* bus = busses + (kStormBus - 1) * blockSize;
+        bool everyFrame = a.random.below(4) == 0;
+        for (int i = 0; i < blockSize; i++) {
+            if (everyFrame || i == 0) a.storm = !a.storm;
+            bus[i] = a.storm ? 10.0f : 0.0f;
+        }
+    }
+    if (a.attacks & kAttackClock) {
+        float* bus = busses + (kClockBus - 1) * blockSize;
+        if (a.random.below(256) == 0) a.clockHz = powf(12000.0f, a.random.uniform());
+        for (int i = 0; i < blockSize; i++) {
+            a.clockPhase += a.clockHz / kStressSampleRate;
+            a.clockPhase -= floorf(a.clockPhase);
+            bus[i] = (a.clockPhase < 0.5f) ? 5.0f : 0.0f;
+        }
+        a.clockHz *= 1.0002f;
+        if (a.clockHz > 12000.0f) a.clockHz = 1.0f;
+    }
+}
+
+// ============================================================================
+// RUNNING
+// ============================================================================
+
+struct StressResult {
+    std::string name;
+    uint64_t blocks;
+    double meanNs;
+    double p50Ns, p99Ns, p999Ns, maxNs;
+    double maxSeconds;       // Where in the run the worst block fell
+    double budgetPercent;    // Worst block against the block's real-time duration
+    uint64_t nonFiniteBlocks;
+    double firstNonFiniteSeconds;
+    float peak;              // Largest finite |sample| on any output
+};
+
+static double nowSeconds() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int findParameter(const NtStubInstance& instance, const char* name) {
+    int index = ntStubFindParameter(instance, name);
+    if (index < 0) fprintf(stderr, "drifters_stress: no parameter '%s'\n", name);
+    return index;
+}
+
+static bool setParameter(NtStubInstance& instance, const char* name, int value) {
+    int index = findParameter(instance, name);
+    if (index < 0) return false;
+    instance.values[index] = (int16_t)value;
+    return true;
+}
+
+static double percentile(const std::vector<double>& sorted, double p) {
+    size_t i = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return sorted[i];
+}
+
+static bool runScenario(const StressScenario& scenario, const std::vector<float>& input, double seconds,
+                        int blockSize, uint32_t seed, StressResult& result) {
+    // A short live buffer so grains reach recorded audio between flips
+    std::vector<int32_t> specs = ntStubDefaultSpecifications();
+    specs[ntStubFindSpecification("Live seconds")] = 1;
+
+    NtStubInstance instance;
+    if (!ntStubCreate(instance, specs.data())) return false;
+
+    bool ok = true;
+    for (int c = 0; c < kNumCvInputs; c++) ok &= setParameter(instance, cvInputs[c], kFirstCvBus + c);
+    ok &= setParameter(instance, "Storm Gate", kStormBus);
+    ok &= setParameter(instance, "Clock", kClockBus);
+    for (int o = 0; o < kNumOutputs; o++) ok &= setParameter(instance, outputs[o], kFirstOutputBus + o);
+    ok &= setParameter(instance, "Out L mode", 1);
+    ok &= setParameter(instance, "Out R mode", 1);
+    for (size_t i = 0; ok && i < scenario.params.size(); i++) {
+        std::string s = scenario.params[i];
+        size_t eq = s.rfind('=');
+        ok = setParameter(instance, s.substr(0, eq).c_str(), atoi(scenario.params[i] + eq + 1));
+    }
+
+    int performance[kNumPerformanceParams];
+    for (int i = 0; ok && i < kNumPerformanceParams; i++) {
+        performance[i] = findParameter(instance, performanceParams[i]);
+        ok = performance[i] >= 0;
+    }
+    const int folderParam = findParameter(instance, "Folder");
+    const int sampleParam = findParameter(instance, "Sample");
+    const int liveParam = findParameter(instance, "Live Mode");
+    const int freezeParam = findParameter(instance, "Freeze");
+    const int inputRParam = findParameter(instance, "Input R");
+    if (!ok || folderParam < 0 || sampleParam < 0 || liveParam < 0 || freezeParam < 0 || inputRParam < 0) {
+        ntStubDestroy(instance);
+        return false;
+    }
+    ntStubAnnounceParameters(instance);
+
+    Adversary a;
+    memset(&a, 0, sizeof(a));
+    a.random.state = seed ? seed : 1;
+    a.attacks = scenario.attacks;
+    a.clockHz = 1.0f;
+    a.inputR = 2;
+
+    const uint64_t warmupFrames = (uint64_t)(kWarmupSeconds * kStressSampleRate);
+    const uint64_t totalFrames = warmupFrames + (uint64_t)(seconds * kStressSampleRate);
+    const uint64_t drawInterval = (uint64_t)(kStressSampleRate / kDrawRate);
+    const uint64_t inputFrames = input.size() / 2;
+    std::vector<float> busses(kStubNumBusses * blockSize);
+    std::vector<double> costs;
+    costs.reserve((size_t)(totalFrames / blockSize));
+    uint64_t nextDraw = 0;
+    double maxCost = -1;
+
+    result.name = scenario.name;
+    result.nonFiniteBlocks = 0;
+    result.firstNonFiniteSeconds = -1;
+    result.maxSeconds = 0;
+    result.peak = 0;
+
+    // The warm-up lets the first sample load and be analysed; the attacks
+    // and the measurements start together after it
+    for (uint64_t frame = 0; frame < totalFrames; frame += blockSize) {
+        ntStubPumpLoads();
+        const bool measured = frame >= warmupFrames;
+
+        std::fill(busses.begin(), busses.end(), 0.0f);
+        int busL = ntStubAudioBus(instance, kNT_unitAudioInput, 0);
+        int busR = ntStubAudioBus(instance, kNT_unitAudioInput, 1);
+        for (int i = 0; i < blockSize; i++) {
+            const float* in = &input[2 * ((frame + i) % inputFrames)];
+            if (busL >= 0) busses[busL * blockSize + i] = in[0];
+            if (busR >= 0) busses[busR * blockSize + i] = in[1];
+        }
+        if (measured) {
+            changeParameters(a, instance, performance, folderParam, sampleParam, liveParam, freezeParam, inputRParam);
+            fillCv(a, busses.data(), blockSize);
+        }
+
+        double start = nowSeconds();
+        instance.factory->step(instance.algorithm, busses.data(), blockSize / 4);
+        double cost = nowSeconds() - start;
+
+        if (frame >= nextDraw && instance.factory->draw) {
+            instance.factory->draw(instance.algorithm);
+            nextDraw += drawInterval;
+        }
+        if (!measured) continue;
+
+        const double at = (double)(frame - warmupFrames) / kStressSampleRate;
+        costs.push_back(cost);
+        if (cost > maxCost) {
+            maxCost = cost;
+            result.maxSeconds = at;
+        }
+        bool finite = true;
+        for (int o = 0; o < kNumOutputs; o++) {
+            const float* bus = &busses[(kFirstOutputBus - 1 + o) * blockSize];
+            for (int i = 0; i < blockSize; i++) {
+                if (!std::isfinite(bus[i])) finite = false;
+                else result.peak = std::max(result.peak, fabsf(bus[i]));
+            }
+        }
+        if (!finite) {
+            if (result.nonFiniteBlocks++ == 0) result.firstNonFiniteSeconds = at;
+        }
+    }
+    ntStubDestroy(instance);
+
+    double sum = 0;
+    for (size_t i = 0; i < costs.size(); i++) sum += costs[i];
+    std::sort(costs.begin(), costs.end());
+    result.blocks = costs.size();
+    result.meanNs = sum * 1e9 / costs.size();
+    result.p50Ns = percentile(costs, 0.5) * 1e9;
+    result.p99Ns = percentile(costs, 0.99) * 1e9;
+    result.p999Ns = percentile(costs, 0.999) * 1e9;
+    result.maxNs = costs.back() * 1e9;
+    result.budgetPercent = costs.back() * kStressSampleRate / blockSize * 100.0;
+    return true;
+}
+
+// ============================================================================
+// RESULTS
+// ============================================================================
+
+static bool writeResults(const char* path, const std::vector<StressResult>& results, int blockSize, uint32_t seed) {
+    FILE* f = fopen(path, "w");
+    if (!f) return false;
+    fprintf(f, "[\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const StressResult& r = results[i];
+        fprintf(f, "  {\"name\": \"%s\", \"block_size\": %d, \"seed\": %u, \"blocks\": %llu, "
+                   "\"mean_ns\": %.0f, \"p50_ns\": %.0f, \"p99_ns\": %.0f, \"p999_ns\": %.0f, "
+                   "\"max_ns\": %.0f, \"max_at_seconds\": %.4f, \"max_budget_percent\": %.1f, "
+                   "\"non_finite_blocks\": %llu, \"first_non_finite_seconds\": %.4f, \"peak\": %.3f}%s\n",
+                r.name.c_str(), blockSize, seed, (unsigned long long)r.blocks,
+                r.meanNs, r.p50Ns, r.p99Ns, r.p999Ns, r.maxNs, r.maxSeconds, r.budgetPercent,
+                (unsigned long long)r.nonFiniteBlocks, r.firstNonFiniteSeconds, r.peak,
+                (i + 1 < results.size()) ? "," : "");
+    }
+    fprintf(f, "]\n");
+    fclose(f);
+    return true;
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+static void usage() {
+    printf("Usage: drifters_stress [options]\n"
+           "\n"
+           "  -o FILE              Write results as JSON\n"
+           "  -t SECONDS           Length of each run after a 1s warm-up (default 10)\n"
+           "  -b FRAMES            Block size, a multiple of 4 (default 32)\n"
+           "  --seed N             Seed for the automation (default 1)\n"
+           "  --fail-over PCT      Exit with 3 if a worst block takes more than PCT%% of\n"
+           "                       its real-time duration\n"
+           "  --filter TEXT        Only run scenarios whose name contains TEXT\n"
+           "  -q                   Don't print per-scenario results\n"
+           "\n"
+           "Exits with 2 if any output went NaN or infinite.\n");
+}
+
+int main(int argc, char** argv) {
+    const char* outputPath = NULL;
+    const char* filter = NULL;
+    double seconds = 10.0;
+    double failOver = -1;
+    int blockSize = 32;
+    uint32_t seed = 1;
+    bool quiet = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (arg == "-h" || arg == "--help") {
+            usage();
+            return 0;
+        } else if (arg == "-q") {
+            quiet = true;
+        } else if (arg == "-o" && hasValue) {
+            outputPath = argv[++i];
+        } else if (arg == "-t" && hasValue) {
+            seconds = atof(argv[++i]);
+        } else if (arg == "-b" && hasValue) {
+            blockSize = atoi(argv[++i]);
+        } else if (arg == "--seed" && hasValue) {
+            seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (arg == "--fail-over" && hasValue) {
+            failOver = atof(argv[++i]);
+        } else if (arg == "--filter" && hasValue) {
+            filter = argv[++i];
+        } else {
+            fprintf(stderr, "drifters_stress: unknown option '%s'\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (blockSize < 4 || blockSize % 4) {
+        fprintf(stderr, "drifters_stress: block size must be a positive multiple of 4\n");
+        return 1;
+    }
+    if (NT_globals.sampleRate != kStressSampleRate) {
+        fprintf(stderr, "drifters_stress: run at %uHz (NT_SAMPLE_RATE is %u)\n", kStressSampleRate, NT_globals.sampleRate);
+        return 1;
+    }
+    if (!ntStubFactory()) {
+        fprintf(stderr, "drifters_stress: plugin has no factory\n");
+        return 1;
+    }
+
+    // Material the sample switches land on, awkward cases included: a file
+    // too short to play, silence, a 96kHz file and a mono one
+    std::vector<float> sample = makeMaterial(4 * kStressSampleRate, kStressSampleRate, 1);
+    std::vector<float> hires = makeMaterial(2 * 96000, 96000, 3);
+    std::vector<float> input = makeMaterial(3 * kStressSampleRate, kStressSampleRate, 2);
+    std::vector<float> noise(input.size());
+    uint32_t noiseState = 3;
+    for (size_t i = 0; i < noise.size(); i++) noise[i] = 0.5f * materialNoise(noiseState);
+    std::vector<float> silence(2 * kStressSampleRate, 0.0f);
+    std::vector<float> mono((size_t)kStressSampleRate / 2);
+    for (size_t i = 0; i < mono.size(); i++) mono[i] = sample[2 * i];
+    ntStubAddSample("stress", "material.wav", sample.data(), (uint32_t)(sample.size() / 2), 2, kStressSampleRate);
+    ntStubAddSample("stress", "hires.wav", hires.data(), (uint32_t)(hires.size() / 2), 2, 96000);
+    ntStubAddSample("stress", "mono.wav", mono.data(), (uint32_t)mono.size(), 1, 44100);
+    ntStubAddSample("stress", "silence.wav", silence.data(), (uint32_t)(silence.size() / 2), 2, kStressSampleRate);
+    ntStubAddSample("stress", "tiny.wav", sample.data(), 64, 2, kStressSampleRate);
+    ntStubAddSample("other", "material.wav", input.data(), (uint32_t)(input.size() / 2), 2, kStressSampleRate);
+
+    std::vector<StressResult> results;
+    bool nonFinite = false, overBudget = false, scenarioOverBudget = false;
+    if (!quiet) {
+        printf("%-16s %9s %9s %9s %9s %9s %8s %8s\n", "scenario", "mean us", "p50 us", "p99 us",
+               "p99.9 us", "max us", "budget", "NaN/Inf");
+    }
+    std::vector<StressScenario> scenarios = buildScenarios();
+    for (size_t i = 0; i < scenarios.size(); i++) {
+        if (filter && strstr(scenarios[i].name, filter) == NULL) continue;
+        StressResult r;
+        const StressScenario& scenario = scenarios[i];
+        if (!runScenario(scenario, scenario.noiseInput ? noise : input, seconds, blockSize, seed, r)) return 1;
+        if (!quiet) {
+            printf("%-16s %9.2f %9.2f %9.2f %9.2f %9.2f %7.1f%% %8llu", r.name.c_str(), r.meanNs * 1e-3,
+                   r.p50Ns * 1e-3, r.p99Ns * 1e-3, r.p999Ns * 1e-3, r.maxNs * 1e-3, r.budgetPercent,
+                   (unsigned long long)r.nonFiniteBlocks);
+            if (r.nonFiniteBlocks) printf("  first at %.4fs", r.firstNonFiniteSeconds);
+            printf("\n");
+        }
+        nonFinite |= r.nonFiniteBlocks > 0;
+        overBudget |= failOver >= 0 && r.budgetPercent > failOver;
+        double p999Percent = r.p999Ns * 1e-9 * kStressSampleRate / blockSize * 100.0;
+        if (scenario.budgetPercent > 0 && p999Percent > scenario.budgetPercent) {
+            fprintf(stderr, "drifters_stress: %s p99.9 block took %.1f%% of its real-time duration (limit %.1f%%)\n",
+                    r.name.c_str(), p999Percent, scenario.budgetPercent);
+            scenarioOverBudget = true;
+        }
+        results.push_back(r);
+    }
+
+    if (outputPath && !writeResults(outputPath, results, blockSize, seed)) {
+        fprintf(stderr, "drifters_stress: can't write %s\n", outputPath);
+        return 1;
+    }
+    if (nonFinite) {
+        fprintf(stderr, "drifters_stress: output went NaN or infinite\n");
+        return 2;
+    }
+    if (overBudget) {
+        fprintf(stderr, "drifters_stress: a block took more than %.1f%% of its real-time duration\n", failOver);
+        return 3;
+    }
+    if (scenarioOverBudget) return 3;
+    return 0;
+}